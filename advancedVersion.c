@@ -1,9 +1,8 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <semaphore.h>
@@ -13,11 +12,98 @@
 #include <errno.h>
 #include <sys/time.h>
 #include <sys/mman.h>
-
-#define MAX_CITIES 20
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <stdint.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "tour.h"
+#include "tspCore.h"
+
+#define MAX_CITIES 10000
 #define MAX_ITERATIONS 1000000000
 #define MAX_PROCESSES 100
 
+// Reasons for a run to stop, reported at the end of the program
+#define STOP_NONE 0
+#define STOP_TIME 1
+#define STOP_TARGET 2
+#define STOP_BOUND 3
+
+// Backends for the per-run shared memory segment
+#define SHM_ANONYMOUS 0
+#define SHM_POSIX 1
+#define SHM_MEMFD 2
+
+// Tour representations selectable from the command line
+#define TOUR_AUTO 0
+#define TOUR_ARRAY 1
+#define TOUR_LIST 2
+
+// Mutation operators and their selection
+#define NUM_OPERATORS 5
+#define SCRAMBLE_MIN 3         // Shortest run shuffled by scramble
+#define SCRAMBLE_MAX 6         // Longest run shuffled by scramble
+#define OPERATOR_BATCH 32      // Moves made with an operator before the next selection
+#define BANDIT_DISCOUNT 0.995  // Weight kept by past batches at every selection
+#define BANDIT_EXPLORATION 0.5 // Weight of the exploration bonus of the selection
+
+// Huge pages and NUMA placement
+#define HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+#define MAX_NUMA_NODES 64
+
+// Elite archive of distinct good tours shared by the workers
+#define MAX_ELITE 32
+
+// Search modes of the workers
+#define MODE_HILL 0
+#define MODE_TABU 1
+#define MODE_ILS 2
+
+// Iterated local search
+#define KICK_DOUBLE_BRIDGE 0  // Reconnect three cut segments of the tour in another order
+#define KICK_SEGMENT 1        // Shuffle a random run of cities
+#define KICK_SEGMENT_MIN 4    // Shortest run shuffled by a segment kick
+#define KICK_SEGMENT_MAX 32   // Longest run shuffled by a segment kick
+#define ACCEPT_BETTER 0       // Continue from the new local optimum only if it is not worse
+#define ACCEPT_ALWAYS 1       // Always continue from the new local optimum (random walk)
+#define ACCEPT_THRESHOLD 2    // Continue from it if it is within a percentage of the incumbent
+
+// Tabu search
+#define TABU_CANDIDATES 64           // Moves sampled per tabu move
+#define TABU_VISITED_SIZE (1 << 18)  // Slots of the visited tour set (a power of two)
+
+// Cluster decomposition
+#define CLUSTERS_AUTO -1          // Cluster count chosen so that every cluster can be solved exactly
+#define HELD_KARP_MAX_CITIES 13   // Largest cluster solved exactly with Held-Karp
+#define KMEDOIDS_ITERATIONS 20    // Most assignment and update rounds of k-medoids
+
+// Best tour exchange between instances over TCP
+#define MAX_PEERS 64
+#define NET_HELLO 1                          // First message on a connection, identifies the instance
+#define NET_FULL 2                           // Whole tour
+#define NET_DELTA 3                          // Positions where the tour differs from the last one sent
+#define DEFAULT_SYNC_INTERVAL 100            // Milliseconds between exchanges
+#define DEFAULT_NET_BANDWIDTH (1024 * 1024)  // Bytes per second sent to each peer
+#define NET_POLL_INTERVAL 20                 // Longest wait for network events, in milliseconds
+#define NET_TIMEOUT 5000                     // Milliseconds a connection or a half-moved message may stall
+#define NET_FINAL_FLUSH 1000                 // Milliseconds spent delivering the final tour at exit
+
+// Dynamic instance updates
+#define MAX_UPDATES 256        // Update batches whose recovery is reported
+#define MAX_BEST_EVENTS 8192   // Improvements of the shared best kept for the recovery report
+#define RECOVERY_STEP 0.1      // Percentage an improvement must gain over the last one kept to be kept
+#define RECOVERY_GAP 1.0       // Percentage above its final distance at which a batch counts as recovered
+
 // Structure that stores the best solution
 typedef struct
 {
@@ -27,271 +113,3226 @@ typedef struct
     int process_id;
 } Solution;
 
+// Statistics of one mutation operator
+typedef struct
+{
+    long long batches;      // Times the operator was selected
+    long long moves;        // Moves tried with the operator
+    long long improvements; // Moves that shortened the tour
+    long long gain;         // Total distance removed by the operator
+    long long time_ns;      // Time spent running the operator
+} OperatorStats;
+
+// Per-worker state of the operator selection bandit
+typedef struct
+{
+    double reward[NUM_OPERATORS]; // Discounted sum of rewards of every operator
+    double weight[NUM_OPERATORS]; // Discounted number of batches of every operator
+    double reward_scale;          // Largest recent improvement rate, used to normalize rewards
+    OperatorStats stats[NUM_OPERATORS];
+} OperatorBandit;
+
+// Mutation operator: applies an improving move to a tour and returns the change in distance
+typedef struct
+{
+    const char *name;
+    int (*mutate)(Tour *tour);
+} MutationOperator;
+
+// Member of the elite archive, replaced without locks through its version counter
+typedef struct
+{
+    unsigned int version;    // Even while the slot is stable, odd while a process rewrites it
+    int distance;            // Distance of the stored tour, INT_MAX when the slot is empty
+    unsigned long long hash; // Hash of the edges of the stored tour, used to reject duplicates
+    int instance_version;    // Version of the instance the stored tour belongs to
+    int path[MAX_CITIES];
+} EliteSlot;
+
+// Statistics of the tabu search of one worker
+typedef struct
+{
+    long long moves;           // Moves made
+    long long repeats_skipped; // Candidates skipped because they led to a visited tour
+    long long tabu_rejected;   // Candidates skipped because a city was tabu
+    long long aspirations;     // Moves allowed because they beat the shared best
+} TabuStats;
+
+// Per-worker state of the tabu search
+typedef struct
+{
+    int *tabu_until;             // Iteration until which each city may not be moved
+    unsigned long long *visited; // Open-addressing set of the hashes of visited tours
+    int visited_count;           // Number of hashes in the visited set
+    unsigned long long hash;     // Zobrist hash of the current tour
+    int tenure;                  // Iterations a moved city stays tabu
+    TabuStats stats;
+} TabuState;
+
+// Statistics of the iterated local search of one worker
+typedef struct
+{
+    long long kicks;     // Local optima kicked out of
+    long long accepted;  // Local optima accepted as the new incumbent
+    long long improved;  // Local optima shorter than the incumbent
+} IlsStats;
+
+// Per-worker state of the iterated local search
+typedef struct
+{
+    int *path;      // Incumbent local optimum that kicks start from
+    int distance;   // Distance of the incumbent (INT_MAX before the first local optimum)
+    IlsStats stats;
+} IlsState;
+
+// Header of every message exchanged between instances, sent in network byte order
+typedef struct
+{
+    uint32_t type;        // NET_HELLO, NET_FULL or NET_DELTA
+    uint32_t num_cities;  // Size of the instance of the sender
+    uint32_t checksum;    // Checksum of the distance matrix of the sender
+    int32_t distance;     // Distance of the tour (INT_MAX in a hello)
+    int32_t lower_bound;  // Lower bound known to the sender
+    uint32_t count;       // Cities of a full tour, or (position, city) pairs of a delta, that follow
+} NetHeader;
+
+// Connection to another instance and the tours both ends last exchanged on it
+typedef struct
+{
+    int fd;
+    int greeted;           // Whether the hello of the other end was accepted
+    int *sent;             // Last tour sent, the base of the next delta sent
+    int *received;         // Last tour received, the base of the next delta received
+    int sent_distance;     // Distance of the last tour sent (INT_MAX before the first)
+    int received_distance; // Distance of the last tour received (INT_MAX before the first)
+    double tokens;         // Bytes that may be sent right now
+    char *inbox;           // Message being received: its header, then its entries
+    size_t inbox_used;     // Bytes of that message received so far
+    char *outbox;          // Message being sent
+    size_t outbox_size;    // Bytes of that message
+    size_t outbox_sent;    // Bytes of it already sent
+    long last_progress;    // When bytes last moved on the connection, for the stall timeout
+    int lost;              // Set when the connection failed and the peer must be dropped
+} Peer;
+
+// Traffic of the tour exchange
+typedef struct
+{
+    long long full_sent;
+    long long deltas_sent;
+    long long bytes_sent;
+    long long deferred;    // Exchanges postponed by the bandwidth limit
+    long long received;
+    long long bytes_received;
+    long long adopted;     // Received tours that became the best of this instance
+    long long stalled;     // Peers dropped because a message stopped moving for NET_TIMEOUT
+    int peers_seen;
+} NetStats;
+
+// Improvement of the shared best, kept to report how quality recovers after updates
+typedef struct
+{
+    long time;            // Milliseconds from the start
+    int distance;
+    int instance_version; // Version of the instance the tour belongs to
+} BestEvent;
+
+// Batch of instance updates applied by the parent
+typedef struct
+{
+    long time;            // Milliseconds from the start
+    int instance_version; // Version of the instance after the batch
+    int edges;            // Distances changed
+    int removed;          // Cities removed
+    int added;            // Cities added
+    int best_before;      // Best distance on the instance before the batch
+    int first_distance;   // First tour published after the batch (0 while there is none)
+    long first_time;
+    int last_distance;    // Best tour published before the next batch or the end
+    long last_time;
+    int kept_distance;    // Distance of the last improvement kept in the event log
+} UpdateRecord;
+
+// Layout of the per-run shared memory segment
+typedef struct
+{
+    Solution best;
+    struct timeval best_time;
+    int stop_reason;
+    sem_t semaphore;
+    OperatorStats operator_stats[MAX_PROCESSES][NUM_OPERATORS];
+    EliteSlot elite[MAX_ELITE];
+    int restarts[MAX_PROCESSES];
+    int numa_affinity_error[MAX_PROCESSES]; // errno of sched_setaffinity in every worker, 0 when it was pinned
+    int numa_policy_error[MAX_PROCESSES];   // errno of set_mempolicy in every worker, 0 when it prefers its node
+    TabuStats tabu_stats[MAX_PROCESSES];
+    IlsStats ils_stats[MAX_PROCESSES];
+    int cluster_next;                // Next cluster to be claimed by a worker
+    int clusters_done;               // Clusters whose sub-tour is written
+    int clusters_exact;              // Clusters solved exactly by Held-Karp
+    int cluster_stitched;            // Set once cluster_tours holds the stitched tour
+    int stitched_distance;           // Distance of the stitched tour
+    long stitch_time;                // Milliseconds from the start until the tour was stitched
+    int cluster_tours[MAX_CITIES];   // Sub-tour of every cluster at its offset, then the stitched tour
+    int instance_version;            // Even while the instance is stable, odd while the parent updates it
+    int active_count;                // Number of cities in the instance
+    int active[MAX_CITIES];          // Cities in the instance
+    int city_added[MAX_CITIES + 1];  // Instance version in which each city number was last given out by an add
+    int num_updates;
+    UpdateRecord updates[MAX_UPDATES];
+    int num_best_events;
+    BestEvent best_events[MAX_BEST_EVENTS];
+} SharedSegment;
+
 // Global variables
 int num_cities;
 int *distance_matrix;
+int matrix_stride;               // Row length of the matrix: the cities of the file plus the reserved ones
+int active_cities[MAX_CITIES];   // Cities in the instance, the first num_cities entries are valid
+TspContext context;              // Instance and random state of the shared kernels, see update_context
+SharedSegment *shared_segment;
 Solution *shared_memory;
 sem_t *semaphore;
-int shm_id;
-volatile sig_atomic_t update_signal = 0;
+int shm_mode = SHM_ANONYMOUS; // Backend used for the shared memory segment
+char shm_name[64] = "";       // Name of the POSIX segment while it exists
+pid_t segment_owner = -1;     // Process that created and must release the segment
 pid_t child_processes[MAX_PROCESSES];
 int num_child_processes = 0;
 struct timeval start_program_time, *current_time, best_time;
 Solution best_solution;
-int synchronized_this_iteration = 0;
+int *stop_reason;          // Shared flag telling every worker why (and that) it must stop
+int target_distance = -1;  // Stop as soon as a tour this short is found (-1 disables it)
+double bound_gap = 0.0;    // Stop when the best tour is within this percentage of the lower bound
+int use_bound_stop = 1;    // Whether the lower bound is used as a stopping criterion
+int lower_bound = 0;       // Lower bound on the optimal tour computed at startup
+int tour_mode = TOUR_AUTO; // Tour representation requested on the command line
+int use_tour_list = 0;     // Whether workers use the two-level list tour
+int matrix_symmetric = 1;  // Whether d[i][j] == d[j][i] for every pair of cities
+int fixed_operator = -1;   // Mutation operator forced on the command line (-1 selects adaptively)
+int elite_size = 8;        // Number of tours kept in the elite archive (0 disables it)
+int stagnation_limit = 0;  // Moves without improvement before a worker restarts (0 scales with the instance)
+int search_mode = MODE_HILL; // Search run by the workers
+int tabu_tenure = 0;         // Base tabu tenure (0 scales with the instance)
+int stagnation_time = 0;     // Milliseconds without improvement before a worker restarts or kicks (0 disables it)
+int kick_type = KICK_DOUBLE_BRIDGE;    // Perturbation of the iterated local search
+int accept_criterion = ACCEPT_BETTER;  // Acceptance criterion of the iterated local search
+double accept_threshold = 0.0;         // Percentage above the incumbent accepted with ACCEPT_THRESHOLD
+int num_clusters = 0;      // Clusters the cities are split into (0 disables the decomposition)
+int cluster_start[MAX_CITIES + 1]; // Offset of every cluster in cluster_cities and cluster_tours
+int cluster_cities[MAX_CITIES];    // Cities grouped by cluster
+int cluster_medoid[MAX_CITIES];    // Medoid city (numbered from 0) of every cluster
+int listen_port = 0;       // Port accepting other instances when this instance coordinates (0 disables it)
+char *coordinator_address = NULL;          // host:port of the coordinator when this instance is a worker
+int sync_interval = DEFAULT_SYNC_INTERVAL; // Milliseconds between exchanges with the other instances
+long net_bandwidth = DEFAULT_NET_BANDWIDTH; // Bytes per second sent to each peer (0 removes the limit)
+uint32_t matrix_checksum = 0;              // Checksum of the distance matrix, so only instances of the same problem talk
+int listen_fd = -1;
+int connecting_fd = -1;    // Socket of a connection to the coordinator still being established
+long connect_started = 0;  // When that connection was started
+Peer peers[MAX_PEERS];
+int num_peers = 0;
+NetStats net_stats;
+char *updates_path = NULL; // File or FIFO the instance updates are read from
+int reserve_cities = 0;    // Matrix rows reserved for cities added by updates
+int updates_fd = -1;
+char city_active[MAX_CITIES + 1]; // Whether every city is in the instance, kept by the parent
+int instance_version = 0;  // Version of the instance the tours of this process belong to
+int use_hugepages = 0;     // Whether the matrix and the shared segment are backed by huge pages
+int use_numa = 0;          // Whether the matrix is replicated per NUMA node with workers bound to their node
+int num_numa_nodes = 1;    // Number of NUMA nodes with CPUs
+int numa_node_ids[MAX_NUMA_NODES];          // Kernel number of every NUMA node used
+cpu_set_t numa_cpus[MAX_NUMA_NODES];        // CPUs of every NUMA node used
+int *matrix_replicas[MAX_NUMA_NODES];       // Copy of the distance matrix local to every NUMA node
+int numa_replicas_bound = 0;                // Replicas whose pages mbind actually placed on their node
+const char *matrix_backing = "regular pages";  // Pages backing the distance matrix
+const char *segment_backing = "regular pages"; // Pages backing the shared segment
+
+// Function to get the length of a mapping, rounded to whole huge pages when they are used
+size_t mapping_size(size_t size)
+{
+    if (!use_hugepages)
+    {
+        return size;
+    }
+    return (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
 
-// Function to initialize shared memory and semaphore
-void initialize_shared_memory()
+// Function to map anonymous memory, backed by huge pages when they were requested
+// Tries explicit huge pages first and falls back to transparent huge pages, then to regular pages
+void *map_memory(size_t size, int flags, const char **backing)
 {
-    // Set protection and visibility flags for memory mapping
-    int sem_protection = PROT_READ | PROT_WRITE;
-    int sem_visibility = MAP_ANONYMOUS | MAP_SHARED;
+    int protection = PROT_READ | PROT_WRITE;
+    size = mapping_size(size);
+
+    if (use_hugepages)
+    {
+        void *memory = mmap(NULL, size, protection, flags | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED)
+        {
+            *backing = "hugetlb pages";
+            return memory;
+        }
+    }
 
-    // Allocate memory for current_time using memory mapping
-    current_time = mmap(NULL, sizeof(struct timeval), sem_protection, sem_visibility, 0, 0);
+    void *memory = mmap(NULL, size, protection, flags | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+        return NULL;
+    }
+    *backing = use_hugepages && madvise(memory, size, MADV_HUGEPAGE) == 0 ? "transparent huge pages" : "regular pages";
+    return memory;
+}
 
-    // Generate a key for shared memory using ftok
-    key_t key = ftok(".", 'a');
+// Function to create a shared memory region of the given size using the selected backend
+void *allocate_shared_segment(size_t size)
+{
+    // Set protection flags for memory mapping
+    int protection = PROT_READ | PROT_WRITE;
+    int fd = -1;
+    size = mapping_size(size);
 
-    // Create a shared memory segment
-    shm_id = shmget(key, sizeof(Solution), IPC_CREAT | 0666);
-    if (shm_id == -1)
+    if (shm_mode == SHM_ANONYMOUS)
     {
-        perror("Error creating shared memory");
-        exit(EXIT_FAILURE);
+        // Anonymous mapping inherited by the forked workers, nothing to name or unlink
+        return map_memory(size, MAP_SHARED, &segment_backing);
     }
 
-    // Attach the shared memory segment to the process
-    shared_memory = (Solution *)shmat(shm_id, NULL, 0);
-    if (shared_memory == (Solution *)-1)
+    if (shm_mode == SHM_POSIX)
     {
-        perror("Error attaching shared memory");
-        exit(EXIT_FAILURE);
+        // Try unique names built from the pid, the clock and a counter until one is free
+        for (int attempt = 0; fd == -1 && attempt < 100; ++attempt)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            snprintf(shm_name, sizeof(shm_name), "/so2023_tsp.%d.%ld.%d", (int)getpid(), now.tv_nsec, attempt);
+            fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd == -1 && errno != EEXIST)
+            {
+                break;
+            }
+        }
+        if (fd == -1)
+        {
+            shm_name[0] = '\0';
+            return NULL;
+        }
     }
+    else
+    {
+        // The memfd has no name in any shared namespace and disappears with its last mapping
+        // Try a memfd on huge pages first; it only works when the system has huge pages reserved
+        if (use_hugepages)
+        {
+            fd = memfd_create("so2023_tsp", MFD_CLOEXEC | MFD_HUGETLB);
+            if (fd != -1)
+            {
+                void *segment = MAP_FAILED;
+                if (ftruncate(fd, size) == 0)
+                {
+                    segment = mmap(NULL, size, protection, MAP_SHARED, fd, 0);
+                }
+                close(fd);
+                if (segment != MAP_FAILED)
+                {
+                    segment_backing = "hugetlb pages";
+                    return segment;
+                }
+            }
+        }
 
-    // Initialize distance to a large value
-    shared_memory->distance = 100000;
+        fd = memfd_create("so2023_tsp", MFD_CLOEXEC);
+        if (fd == -1)
+        {
+            return NULL;
+        }
+    }
 
-    // Initialize semaphore for synchronization
-    semaphore = sem_open("/my_semaphore", O_CREAT | O_EXCL, 0666, 1);
-    if (semaphore == SEM_FAILED)
+    // Size the segment and map it shared so forked workers see the same pages
+    void *segment = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
     {
-        perror("Error creating semaphore");
-        exit(EXIT_FAILURE);
+        segment = mmap(NULL, size, protection, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (segment == MAP_FAILED)
+    {
+        return NULL;
     }
 
-    // Unlink the semaphore to remove it when the program finishes
-    sem_unlink("/my_semaphore");
+    // File-backed segments can still use transparent huge pages when shmem allows it
+    if (use_hugepages && madvise(segment, size, MADV_HUGEPAGE) == 0)
+    {
+        segment_backing = "transparent huge pages";
+    }
+    return segment;
 }
 
-// Function to generate a random path of cities
-void generate_random_path(int *path, int size)
+// Function to find the NUMA nodes that have CPUs and the CPUs of each of them
+// Returns the number of nodes found, 1 when the system does not expose NUMA information
+int detect_numa_nodes()
 {
-    // Initialize the path with consecutive city numbers
-    for (int i = 0; i < size; ++i)
+    int count = 0;
+
+    for (int node = 0; node < 1024 && count < MAX_NUMA_NODES; ++node)
+    {
+        // Read the CPU list of the node, such as "0-3,8-11"
+        char path[64];
+        char cpulist[4096];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        FILE *file = fopen(path, "r");
+        if (!file)
+        {
+            continue;
+        }
+        if (!fgets(cpulist, sizeof(cpulist), file))
+        {
+            cpulist[0] = '\0';
+        }
+        fclose(file);
+
+        // Parse the ranges of the list into a CPU set
+        CPU_ZERO(&numa_cpus[count]);
+        int cpus = 0;
+        for (char *range = strtok(cpulist, ",\n"); range != NULL; range = strtok(NULL, ",\n"))
+        {
+            int first, last;
+            int fields = sscanf(range, "%d-%d", &first, &last);
+            if (fields < 1)
+            {
+                continue;
+            }
+            if (fields == 1)
+            {
+                last = first;
+            }
+            for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu)
+            {
+                CPU_SET(cpu, &numa_cpus[count]);
+                cpus++;
+            }
+        }
+
+        // Memory-only nodes cannot run workers
+        if (cpus > 0)
+        {
+            numa_node_ids[count++] = node;
+        }
+    }
+
+    if (count == 0)
     {
-        path[i] = i + 1;
+        // Treat the whole machine as a single node
+        CPU_ZERO(&numa_cpus[0]);
+        sched_getaffinity(0, sizeof(cpu_set_t), &numa_cpus[0]);
+        numa_node_ids[0] = 0;
+        count = 1;
     }
+    return count;
+}
 
-    // Shuffle the path using the Fisher-Yates algorithm
-    for (int i = size - 1; i > 0; --i)
+// Function to give every NUMA node its own copy of the distance matrix, allocated on that node
+void replicate_distance_matrix()
+{
+    size_t size = (size_t)matrix_stride * matrix_stride * sizeof(int);
+
+    for (int i = 0; i < num_numa_nodes; ++i)
     {
-        // Generate a random index between 0 and i (inclusive)
-        int j = rand() % (i + 1);
+        // Shared when instance updates must reach the workers reading the replica
+        const char *backing;
+        matrix_replicas[i] = map_memory(size, updates_path != NULL ? MAP_SHARED : MAP_PRIVATE, &backing);
+        if (matrix_replicas[i] == NULL)
+        {
+            perror("Error allocating distance matrix replica");
+            exit(EXIT_FAILURE);
+        }
 
-        // Swap path[i] and path[j]
-        int temp = path[i];
-        path[i] = path[j];
-        path[j] = temp;
+        // Bind the pages to the node before they are touched, so the copy allocates them there
+        unsigned long nodemask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 16] = {0};
+        int node = numa_node_ids[i];
+        nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_mbind, matrix_replicas[i], mapping_size(size), MPOL_BIND, nodemask,
+                    sizeof(nodemask) * 8, 0) == 0)
+        {
+            numa_replicas_bound++;
+        }
+        else
+        {
+            fprintf(stderr, "Warning: could not bind the matrix replica to NUMA node %d (%s)\n", node,
+                    strerror(errno));
+        }
+        memcpy(matrix_replicas[i], distance_matrix, size);
     }
 }
 
-// Function to calculate the total distance of a given path
-int calculate_distance(int *path)
+// Function to point the shared kernels at the instance, after it is read, moved to a replica or updated
+void update_context()
 {
-    // Initialize total distance to 0
-    int total_distance = 0;
+    context.distances = distance_matrix;
+    context.stride = matrix_stride;
+    context.num_cities = num_cities;
+    context.cities = active_cities;
+    context.symmetric = matrix_symmetric;
+}
+
+// Function to bind a worker to the CPUs of its NUMA node and to the local copy of the matrix
+// The outcome of every call is left in the shared segment, so the parent reports the placement that took effect
+void bind_worker_to_node(int process_id)
+{
+    int i = process_id % num_numa_nodes;
+    shared_segment->numa_affinity_error[process_id] =
+        sched_setaffinity(0, sizeof(cpu_set_t), &numa_cpus[i]) == 0 ? 0 : errno;
+    distance_matrix = matrix_replicas[i];
+    update_context();
+
+    // Prefer the local node for everything the worker allocates from now on
+    unsigned long nodemask[MAX_NUMA_NODES / (8 * sizeof(unsigned long)) + 16] = {0};
+    int node = numa_node_ids[i];
+    nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    shared_segment->numa_policy_error[process_id] =
+        syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask, sizeof(nodemask) * 8) == 0 ? 0 : errno;
+}
+
+// Function to print where the matrix replicas and the workers were actually placed, and why a call failed
+void report_numa_placement()
+{
+    int pinned = 0;
+    int local = 0;
+    int affinity_error = 0;
+    int policy_error = 0;
+    for (int i = 0; i < num_child_processes; ++i)
+    {
+        if (shared_segment->numa_affinity_error[i] == 0)
+        {
+            pinned++;
+        }
+        else
+        {
+            affinity_error = shared_segment->numa_affinity_error[i];
+        }
+        if (shared_segment->numa_policy_error[i] == 0)
+        {
+            local++;
+        }
+        else
+        {
+            policy_error = shared_segment->numa_policy_error[i];
+        }
+    }
+
+    printf("NUMA placement: %d/%d matrix replicas bound to their node, %d/%d workers pinned, "
+           "%d/%d workers preferring local memory\n",
+           numa_replicas_bound, num_numa_nodes, pinned, num_child_processes, local, num_child_processes);
+    if (affinity_error != 0)
+    {
+        fprintf(stderr, "Warning: sched_setaffinity failed for %d worker%s (%s)\n", num_child_processes - pinned,
+                num_child_processes - pinned == 1 ? "" : "s", strerror(affinity_error));
+    }
+    if (policy_error != 0)
+    {
+        fprintf(stderr, "Warning: set_mempolicy failed for %d worker%s (%s)\n", num_child_processes - local,
+                num_child_processes - local == 1 ? "" : "s", strerror(policy_error));
+    }
+}
 
-    // Iterate through the cities in the path
-    for (int i = 0; i < num_cities - 1; ++i)
+// Function to release the shared memory and its name, safe to call more than once
+void cleanup_shared_memory()
+{
+    // Only the process that created the segment owns it
+    if (segment_owner != getpid() || shared_segment == NULL)
     {
-        // Add the distance from city i to city i+1
-        total_distance += distance_matrix[(path[i] - 1) * num_cities + (path[i + 1] - 1)];
+        return;
     }
 
-    // Add the distance from the last city back to the starting city
-    total_distance += distance_matrix[(path[num_cities - 1] - 1) * num_cities + (path[0] - 1)];
+    sem_destroy(&shared_segment->semaphore);
+    munmap(shared_segment, mapping_size(sizeof(SharedSegment)));
+    shared_segment = NULL;
 
-    // Return the total distance of the path
-    return total_distance;
+    // Remove the POSIX name so nothing is left behind in /dev/shm
+    if (shm_name[0] != '\0')
+    {
+        shm_unlink(shm_name);
+        shm_name[0] = '\0';
+    }
+}
+
+// Signal handler that terminates the workers and removes the segment name when the run is interrupted
+// Only async-signal-safe calls are made here: the mapping and the semaphore in it go away with the process,
+// so the POSIX name is the only thing that would outlive it
+void handle_termination_signal(int signo)
+{
+    // Workers leave the cleanup to the parent
+    if (segment_owner == getpid())
+    {
+        for (int i = 0; i < num_child_processes; ++i)
+        {
+            kill(child_processes[i], SIGTERM);
+        }
+        if (shm_name[0] != '\0')
+        {
+            shm_unlink(shm_name);
+        }
+    }
+
+    // Terminate with the default action of the signal
+    signal(signo, SIG_DFL);
+    raise(signo);
 }
 
-// Function to perform exchange mutation on a path
-void exchange_mutation(int *path)
+// Function to initialize shared memory and semaphore
+void initialize_shared_memory()
 {
-    // Get the size of the path (number of cities)
-    int size = num_cities;
+    // Create the per-run segment holding the best solution and the synchronization state
+    shared_segment = allocate_shared_segment(sizeof(SharedSegment));
+    if (shared_segment == NULL)
+    {
+        perror("Error creating shared memory");
+        exit(EXIT_FAILURE);
+    }
+    segment_owner = getpid();
 
-    // Choose two random positions to exchange
-    int position1 = rand() % size;
-    int position2;
+    // Release the segment on every exit path of the parent
+    atexit(cleanup_shared_memory);
+    signal(SIGINT, handle_termination_signal);
+    signal(SIGTERM, handle_termination_signal);
+    signal(SIGHUP, handle_termination_signal);
 
-    // Check if both positions are not the same
-    do
+    // Point the shared variables into the segment
+    shared_memory = &shared_segment->best;
+    current_time = &shared_segment->best_time;
+    stop_reason = &shared_segment->stop_reason;
+    *stop_reason = STOP_NONE;
+
+    // Initialize distance to a large value
+    shared_memory->distance = INT_MAX;
+
+    // Start with an empty elite archive
+    for (int i = 0; i < MAX_ELITE; ++i)
     {
-        position2 = rand() % size;
-    } while (position1 == position2);
+        shared_segment->elite[i].distance = INT_MAX;
+    }
 
-    // Swap the cities at the chosen positions
-    int temp = path[position1];
-    path[position1] = path[position2];
-    path[position2] = temp;
+    // Start from the cities of the instance as it was read
+    memcpy(shared_segment->active, active_cities, num_cities * sizeof(int));
+    shared_segment->active_count = num_cities;
+
+    // Initialize a process-shared semaphore inside the segment, so no global name is needed
+    semaphore = &shared_segment->semaphore;
+    if (sem_init(semaphore, 1, 1) == -1)
+    {
+        perror("Error creating semaphore");
+        exit(EXIT_FAILURE);
+    }
 }
 
-// Function to update shared memory with a new solution
-void update_shared_memory(Solution *solution)
+// Function to calculate the total distance of a given path
+int calculate_distance(int *path)
 {
-    // Wait for the semaphore to access shared memory
-    sem_wait(semaphore);
+    return core_path_distance(&context, path);
+}
 
-    // Check if the new solution has a smaller distance or more iterations
-    // than the solution in shared memory
-    if (solution->distance < shared_memory->distance || solution->total_iterations > shared_memory->total_iterations)
+// Function to compute a lower bound on the optimal tour length (Held-Karp 1-tree bound)
+// Uses min(d[i][j], d[j][i]) so the bound is also valid for asymmetric matrices
+// Computed at startup, while the cities of the instance are the first rows of the matrix
+int calculate_lower_bound()
+{
+    int n = num_cities;
+
+    // Trivial instances have a single tour, so its length is the exact bound
+    if (n < 3)
     {
-        // Update the shared memory with the new solution
-        *shared_memory = *solution;
+        int path[MAX_CITIES];
+        core_random_path(&context, path);
+        return n < 2 ? 0 : calculate_distance(path);
+    }
 
-        // Notify the parent process about the update using a signal
-        kill(getppid(), SIGUSR1);
+    double *pi = calloc(n, sizeof(double));        // Node penalties of the subgradient ascent
+    double *key = malloc(n * sizeof(double));      // Prim key of every node
+    int *parent = malloc(n * sizeof(int));         // Prim parent of every node
+    int *degree = malloc(n * sizeof(int));         // Degree of every node in the 1-tree
+    char *in_tree = malloc(n);                     // Prim membership flags
+
+    // Upper bound from the nearest neighbour tour, used to size the subgradient steps
+    int upper_bound = 0;
+    memset(in_tree, 0, n);
+    in_tree[0] = 1;
+    for (int k = 1, current = 0; k <= n; ++k)
+    {
+        int next = 0;
+        int next_cost = INT_MAX;
+        for (int j = 0; j < n && k < n; ++j)
+        {
+            int cost = distance_matrix[current * matrix_stride + j];
+            if (!in_tree[j] && cost < next_cost)
+            {
+                next = j;
+                next_cost = cost;
+            }
+        }
+        upper_bound += distance_matrix[current * matrix_stride + next];
+        in_tree[next] = 1;
+        current = next;
+    }
 
-        // Set the flag to indicate synchronization during this iteration
-        synchronized_this_iteration = 1;
+    // Keep the ascent cheap on large instances: each iteration costs O(n^2)
+    int max_iterations = (int)(2e8 / ((double)n * n));
+    if (max_iterations > 200)
+    {
+        max_iterations = 200;
+    }
+    if (max_iterations < 1)
+    {
+        max_iterations = 1;
     }
 
-    // Release the semaphore
-    sem_post(semaphore);
+    double best_bound = 0;
+    double lambda = 2.0;
+    int stale_iterations = 0;
+
+    for (int iteration = 0; iteration < max_iterations; ++iteration)
+    {
+        // Build a minimum spanning tree over nodes 1..n-1 with Prim's algorithm
+        double tree_cost = 0;
+        memset(in_tree, 0, n);
+        for (int i = 1; i < n; ++i)
+        {
+            key[i] = INFINITY;
+            parent[i] = -1;
+            degree[i] = 0;
+        }
+        key[1] = 0;
+        for (int k = 1; k < n; ++k)
+        {
+            int u = -1;
+            for (int i = 1; i < n; ++i)
+            {
+                if (!in_tree[i] && (u == -1 || key[i] < key[u]))
+                {
+                    u = i;
+                }
+            }
+            in_tree[u] = 1;
+            tree_cost += key[u];
+            if (parent[u] != -1)
+            {
+                degree[u]++;
+                degree[parent[u]]++;
+            }
+            for (int v = 1; v < n; ++v)
+            {
+                if (!in_tree[v])
+                {
+                    int a = distance_matrix[u * matrix_stride + v];
+                    int b = distance_matrix[v * matrix_stride + u];
+                    double cost = (a < b ? a : b) + pi[u] + pi[v];
+                    if (cost < key[v])
+                    {
+                        key[v] = cost;
+                        parent[v] = u;
+                    }
+                }
+            }
+        }
+
+        // Connect node 0 with its two cheapest edges to close the 1-tree
+        int first = -1, second = -1;
+        double first_cost = INFINITY, second_cost = INFINITY;
+        for (int v = 1; v < n; ++v)
+        {
+            int a = distance_matrix[v];
+            int b = distance_matrix[v * matrix_stride];
+            double cost = (a < b ? a : b) + pi[0] + pi[v];
+            if (cost < first_cost)
+            {
+                second = first;
+                second_cost = first_cost;
+                first = v;
+                first_cost = cost;
+            }
+            else if (cost < second_cost)
+            {
+                second = v;
+                second_cost = cost;
+            }
+        }
+        degree[0] = 2;
+        degree[first]++;
+        degree[second]++;
+
+        // The bound is the penalized 1-tree cost minus twice the sum of penalties
+        double bound = tree_cost + first_cost + second_cost;
+        double norm = 0;
+        for (int i = 0; i < n; ++i)
+        {
+            bound -= 2 * pi[i];
+            norm += (double)(degree[i] - 2) * (degree[i] - 2);
+        }
+
+        if (bound > best_bound + 1e-9)
+        {
+            best_bound = bound;
+            stale_iterations = 0;
+        }
+        else if (++stale_iterations >= 10)
+        {
+            // Shrink the step when the bound stops improving
+            lambda /= 2;
+            stale_iterations = 0;
+        }
+
+        // A 1-tree where every node has degree 2 is a tour, so the bound is tight
+        if (norm == 0 || lambda < 1e-4)
+        {
+            break;
+        }
+
+        // Move the penalties along the subgradient (degree - 2)
+        double step = lambda * (upper_bound - bound) / norm;
+        for (int i = 0; i < n; ++i)
+        {
+            pi[i] += step * (degree[i] - 2);
+        }
+    }
+
+    free(pi);
+    free(key);
+    free(parent);
+    free(degree);
+    free(in_tree);
+
+    // Tour lengths are integers, so the bound can be rounded up
+    return (int)ceil(best_bound - 1e-6);
 }
 
-// Function to synchronize child processes by sending signals
-void synchronize_processes()
+// Function to stop every worker once a tour meets the target or the lower bound gap
+// The lower bound only holds for the instance as it was read, so updates turn that criterion off
+void check_stop_criteria(int distance)
 {
-    // Send SIGUSR1 signal to each child process
-    for (int i = 0; i < num_child_processes; ++i)
+    int reason = STOP_NONE;
+
+    if (target_distance >= 0 && distance <= target_distance)
+    {
+        reason = STOP_TARGET;
+    }
+    else if (use_bound_stop && shared_segment->instance_version == 0 && distance <= lower_bound * (1.0 + bound_gap / 100.0))
+    {
+        reason = STOP_BOUND;
+    }
+
+    // Only the first reason is recorded
+    if (reason != STOP_NONE)
+    {
+        __sync_bool_compare_and_swap(stop_reason, STOP_NONE, reason);
+    }
+}
+
+// Function to get the distance between two cities numbered from 1
+int get_distance(int from, int to)
+{
+    return core_distance(&context, from, to);
+}
+
+// Function to calculate the total distance of a tour by following it from any city
+int calculate_tour_distance(Tour *tour)
+{
+    int total_distance = 0;
+    int city = active_cities[0];
+
+    // Add the distance from every city to the next one, including the closing edge
+    for (int i = 0; i < num_cities; ++i)
     {
-        kill(child_processes[i], SIGUSR1);
+        int next = tour_next(tour, city);
+        total_distance += get_distance(city, next);
+        city = next;
     }
 
-    // Introduce a small delay to allow signals to be processed
-    usleep(10000);
+    return total_distance;
+}
+
+// Function to perform exchange mutation on a tour, keeping it only when it shortens the tour
+// Returns the change in distance, or 0 when the exchange was rejected
+int exchange_mutation(Tour *tour)
+{
+    return core_exchange_mutation(&context, tour);
+}
+
+// Function to perform insertion mutation: move a single city to another place
+int insertion_mutation(Tour *tour)
+{
+    return core_move_segment_mutation(&context, tour, 1);
+}
+
+// Function to perform or-opt mutation: move a segment of two or more cities to another place
+int or_opt_mutation(Tour *tour)
+{
+    return core_move_segment_mutation(&context, tour, 2 + rand() % (OR_OPT_MAX - 1));
+}
+
+// Function to perform inversion mutation (2-opt): reverse the path between two edges
+// Returns the change in distance, or 0 when the inversion was rejected
+int inversion_mutation(Tour *tour)
+{
+    return core_inversion_mutation(&context, tour);
 }
 
-// Signal handler function for SIGUSR1
-void handle_update_signal(int signo)
+// Function to perform scramble mutation: shuffle a short run of consecutive cities
+// Returns the change in distance, or 0 when the shuffle was rejected
+int scramble_mutation(Tour *tour)
 {
-    // Set the update_signal flag if the signal is SIGUSR1
-    if (signo == SIGUSR1)
+    int length = SCRAMBLE_MIN + rand() % (SCRAMBLE_MAX - SCRAMBLE_MIN + 1);
+    if (num_cities < length + 2)
+    {
+        return 0;
+    }
+
+    // Read the run and its neighbours
+    int current[SCRAMBLE_MAX];
+    int shuffled[SCRAMBLE_MAX];
+    current[0] = active_cities[rand() % num_cities];
+    for (int i = 1; i < length; ++i)
+    {
+        current[i] = tour_next(tour, current[i - 1]);
+    }
+    int before = tour_prev(tour, current[0]);
+    int after = tour_next(tour, current[length - 1]);
+
+    // Shuffle a copy of the run using the Fisher-Yates algorithm
+    memcpy(shuffled, current, length * sizeof(int));
+    for (int i = length - 1; i > 0; --i)
+    {
+        int j = rand() % (i + 1);
+        int temp = shuffled[i];
+        shuffled[i] = shuffled[j];
+        shuffled[j] = temp;
+    }
+
+    // Compare the cost of the run before and after the shuffle
+    int delta = get_distance(before, shuffled[0]) + get_distance(shuffled[length - 1], after) -
+                get_distance(before, current[0]) - get_distance(current[length - 1], after);
+    for (int i = 0; i < length - 1; ++i)
+    {
+        delta += get_distance(shuffled[i], shuffled[i + 1]) - get_distance(current[i], current[i + 1]);
+    }
+    if (delta >= 0)
+    {
+        return 0;
+    }
+
+    // Write the shuffled order into the tour with at most one swap per position
+    for (int i = 0; i < length; ++i)
+    {
+        if (current[i] == shuffled[i])
+        {
+            continue;
+        }
+        int j = i + 1;
+        while (current[j] != shuffled[i])
+        {
+            j++;
+        }
+        tour_swap(tour, current[i], current[j]);
+        current[j] = current[i];
+        current[i] = shuffled[i];
+    }
+    return delta;
+}
+
+// Mutation operators available to the workers, evaluated from a constant number of edges
+// except inversion on asymmetric matrices, which re-costs every edge of the reversed path
+MutationOperator mutation_operators[NUM_OPERATORS] = {
+    {"exchange", exchange_mutation},
+    {"insertion", insertion_mutation},
+    {"inversion", inversion_mutation},
+    {"scramble", scramble_mutation},
+    {"or-opt", or_opt_mutation}};
+
+// Function to pick the mutation operator for the next batch of moves
+// Uses discounted UCB1, so operators are ranked by their recent improvement per nanosecond
+int select_operator(OperatorBandit *bandit)
+{
+    if (fixed_operator >= 0)
+    {
+        return fixed_operator;
+    }
+
+    // Try every operator once before trusting the estimates
+    double total_weight = 0;
+    for (int k = 0; k < NUM_OPERATORS; ++k)
+    {
+        if (bandit->weight[k] == 0)
+        {
+            return k;
+        }
+        total_weight += bandit->weight[k];
+    }
+
+    // Pick the operator with the best mean reward plus exploration bonus
+    int best = 0;
+    double best_score = -1;
+    for (int k = 0; k < NUM_OPERATORS; ++k)
+    {
+        double mean = bandit->reward[k] / bandit->weight[k];
+        double score = mean + BANDIT_EXPLORATION * sqrt(log(total_weight + 1) / bandit->weight[k]);
+        if (score > best_score)
+        {
+            best = k;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+// Function to record the outcome of a batch of moves made with one operator
+void record_operator_batch(OperatorBandit *bandit, int op, int moves, int improvements, int gain, long time_ns)
+{
+    OperatorStats *stats = &bandit->stats[op];
+    stats->batches++;
+    stats->moves += moves;
+    stats->improvements += improvements;
+    stats->gain += gain;
+    stats->time_ns += time_ns;
+
+    // Reward is the improvement per nanosecond, scaled by the best recent rate
+    double rate = time_ns > 0 ? (double)gain / time_ns : 0;
+    bandit->reward_scale *= BANDIT_DISCOUNT;
+    if (rate > bandit->reward_scale)
+    {
+        bandit->reward_scale = rate;
+    }
+    double reward = bandit->reward_scale > 0 ? rate / bandit->reward_scale : 0;
+
+    // Forget old batches so the choice follows the phase of the search
+    for (int k = 0; k < NUM_OPERATORS; ++k)
+    {
+        bandit->reward[k] *= BANDIT_DISCOUNT;
+        bandit->weight[k] *= BANDIT_DISCOUNT;
+    }
+    bandit->reward[op] += reward;
+    bandit->weight[op] += 1;
+}
+
+// Function to get the hash key of the edge between two cities, the same in both directions
+unsigned long long edge_key(int a, int b)
+{
+    // Mix the ordered pair with the splitmix64 finalizer
+    unsigned long long x = a < b ? (unsigned long long)a * (MAX_CITIES + 1) + b : (unsigned long long)b * (MAX_CITIES + 1) + a;
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+// Function to hash a path as the XOR of its edge keys, so rotations and reversals hash the same
+unsigned long long calculate_path_hash(int *path)
+{
+    unsigned long long hash = 0;
+    for (int i = 0; i < num_cities; ++i)
+    {
+        hash ^= edge_key(path[i], path[(i + 1) % num_cities]);
+    }
+    return hash;
+}
+
+// Function to offer a tour to the elite archive
+// Returns 1 when the tour replaced the worst member, 0 when it was a duplicate or not good enough
+int elite_insert(int *path, int distance)
+{
+    unsigned long long hash = calculate_path_hash(path);
+
+    // A worker that has not repaired its tour after an update must not displace current tours
+    if (instance_version != __atomic_load_n(&shared_segment->instance_version, __ATOMIC_ACQUIRE))
+    {
+        return 0;
+    }
+
+    // Retry a few times when another process is replacing the slot we picked
+    for (int attempt = 0; attempt < 8; ++attempt)
+    {
+        // Find the worst member and reject tours that are already in the archive
+        int worst = -1;
+        int worst_distance = -1;
+        for (int i = 0; i < elite_size; ++i)
+        {
+            EliteSlot *slot = &shared_segment->elite[i];
+            int slot_distance = __atomic_load_n(&slot->distance, __ATOMIC_ACQUIRE);
+
+            // Tours of an instance that was updated since are worth nothing
+            if (__atomic_load_n(&slot->instance_version, __ATOMIC_ACQUIRE) != instance_version)
+            {
+                slot_distance = INT_MAX;
+            }
+            if (slot_distance == distance && __atomic_load_n(&slot->hash, __ATOMIC_ACQUIRE) == hash)
+            {
+                return 0;
+            }
+            if (slot_distance > worst_distance)
+            {
+                worst = i;
+                worst_distance = slot_distance;
+            }
+        }
+        if (worst == -1 || distance >= worst_distance)
+        {
+            return 0;
+        }
+
+        // Claim the slot by making its version odd; only one process can win the exchange
+        EliteSlot *slot = &shared_segment->elite[worst];
+        unsigned int version = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+        if ((version & 1) || !__atomic_compare_exchange_n(&slot->version, &version, version + 1, 0,
+                                                          __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+        {
+            continue;
+        }
+
+        // The slot may have been improved since it was chosen
+        if (slot->distance <= distance && slot->instance_version == instance_version)
+        {
+            __atomic_store_n(&slot->version, version + 2, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        // Write the tour and publish it by making the version even again
+        memcpy(slot->path, path, num_cities * sizeof(int));
+        __atomic_store_n(&slot->hash, hash, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->distance, distance, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->instance_version, instance_version, __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->version, version + 2, __ATOMIC_RELEASE);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Function to copy a member of the elite archive without locking
+// Returns its distance, or INT_MAX when the slot is empty
+int elite_read(int index, int *path)
+{
+    EliteSlot *slot = &shared_segment->elite[index];
+    unsigned int before, after;
+    int distance;
+
+    // Copy again whenever a writer was active during the copy
+    do
+    {
+        before = __atomic_load_n(&slot->version, __ATOMIC_ACQUIRE);
+        distance = __atomic_load_n(&slot->distance, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&slot->instance_version, __ATOMIC_RELAXED) != instance_version)
+        {
+            distance = INT_MAX;
+        }
+        if (distance != INT_MAX)
+        {
+            memcpy(path, slot->path, num_cities * sizeof(int));
+        }
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&slot->version, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+
+    return distance;
+}
+
+// Function to walk from one tour towards another by exchanges and keep the best tour on the way
+// Returns the distance of the best intermediate tour, written to result
+int path_relinking(int *initiating, int *guiding, int *result)
+{
+    int *target = malloc(num_cities * sizeof(int));
+    int *step_distance = malloc(num_cities * sizeof(int));
+
+    // Rotate the guiding tour so both tours start at the same city
+    int offset = 0;
+    while (guiding[offset] != initiating[0])
+    {
+        offset++;
+    }
+    for (int i = 0; i < num_cities; ++i)
+    {
+        target[i] = guiding[(offset + i) % num_cities];
+    }
+
+    // Walk the initiating tour towards the target, fixing one position per exchange
+    Tour tour;
+    if (tour_init(&tour, initiating, num_cities, matrix_stride, 0) == -1)
+    {
+        perror("Error allocating tour");
+        exit(EXIT_FAILURE);
+    }
+    int distance = calculate_tour_distance(&tour);
+    int steps = 0;
+    for (int i = 1; i < num_cities; ++i)
+    {
+        int city = tour.order[i];
+        if (city != target[i])
+        {
+            distance += core_exchange_delta(&context, &tour, city, target[i]);
+            tour_swap(&tour, city, target[i]);
+            step_distance[++steps] = distance;
+        }
+    }
+
+    // Only tours strictly between both ends are new starting points
+    int best_step = 0;
+    int best_distance = INT_MAX;
+    for (int step = 1; step < steps; ++step)
+    {
+        if (step_distance[step] < best_distance)
+        {
+            best_step = step;
+            best_distance = step_distance[step];
+        }
+    }
+
+    // Replay the exchanges up to the best intermediate tour
+    tour_load(&tour, initiating, num_cities);
+    for (int i = 0, k = 0; k < best_step; ++i)
+    {
+        if (tour.order[i] != target[i])
+        {
+            tour_swap(&tour, tour.order[i], target[i]);
+            k++;
+        }
+    }
+    tour_to_path(&tour, result);
+
+    tour_free(&tour);
+    free(target);
+    free(step_distance);
+    return best_step > 0 ? best_distance : calculate_distance(result);
+}
+
+// Function to move a stagnating worker to a new starting tour taken from the elite archive
+// Returns 1 when the tour in path was replaced
+int restart_from_elite(int *path, int *distance)
+{
+    // Pick two random members; empty slots cannot be used
+    int *first = malloc(num_cities * sizeof(int));
+    int *second = malloc(num_cities * sizeof(int));
+    int first_distance = elite_read(rand() % elite_size, first);
+    int second_distance = elite_read(rand() % elite_size, second);
+    int replaced = 0;
+
+    if (first_distance != INT_MAX && second_distance != INT_MAX &&
+        calculate_path_hash(first) != calculate_path_hash(second) && rand() % 2 == 0)
+    {
+        // Relink two distinct members to reach a region between them
+        *distance = path_relinking(first, second, path);
+        replaced = 1;
+    }
+    else if (first_distance != INT_MAX)
+    {
+        // Restart from a single member
+        memcpy(path, first, num_cities * sizeof(int));
+        *distance = first_distance;
+        replaced = 1;
+    }
+
+    free(first);
+    free(second);
+    return replaced;
+}
+
+// Function to compute how the Zobrist hash of a tour changes when two cities are exchanged
+unsigned long long exchange_hash_delta(Tour *tour, int a, int b)
+{
+    int prev_a = tour_prev(tour, a);
+    int next_a = tour_next(tour, a);
+    int prev_b = tour_prev(tour, b);
+    int next_b = tour_next(tour, b);
+
+    // The shared edge of adjacent cities is kept, so only its two outer edges change
+    if (next_a == b)
+    {
+        return edge_key(prev_a, a) ^ edge_key(b, next_b) ^ edge_key(prev_a, b) ^ edge_key(a, next_b);
+    }
+    if (next_b == a)
+    {
+        return edge_key(prev_b, b) ^ edge_key(a, next_a) ^ edge_key(prev_b, a) ^ edge_key(b, next_a);
+    }
+
+    return edge_key(prev_a, a) ^ edge_key(a, next_a) ^ edge_key(prev_b, b) ^ edge_key(b, next_b) ^
+           edge_key(prev_a, b) ^ edge_key(b, next_a) ^ edge_key(prev_b, a) ^ edge_key(a, next_b);
+}
+
+// Function to check whether a tour hash is in the visited set of a tabu search
+int tabu_visited(TabuState *tabu, unsigned long long hash)
+{
+    hash = hash ? hash : 1;
+    for (unsigned long long i = hash & (TABU_VISITED_SIZE - 1);; i = (i + 1) & (TABU_VISITED_SIZE - 1))
+    {
+        if (tabu->visited[i] == hash)
+        {
+            return 1;
+        }
+        if (tabu->visited[i] == 0)
+        {
+            return 0;
+        }
+    }
+}
+
+// Function to add a tour hash to the visited set, forgetting everything when the set fills up
+void tabu_remember(TabuState *tabu, unsigned long long hash)
+{
+    hash = hash ? hash : 1;
+    if (tabu->visited_count >= TABU_VISITED_SIZE / 4 * 3)
+    {
+        memset(tabu->visited, 0, TABU_VISITED_SIZE * sizeof(unsigned long long));
+        tabu->visited_count = 0;
+    }
+
+    unsigned long long i = hash & (TABU_VISITED_SIZE - 1);
+    while (tabu->visited[i] != 0 && tabu->visited[i] != hash)
+    {
+        i = (i + 1) & (TABU_VISITED_SIZE - 1);
+    }
+    if (tabu->visited[i] == 0)
+    {
+        tabu->visited[i] = hash;
+        tabu->visited_count++;
+    }
+}
+
+// Function to make one tabu search move: the best sampled exchange or inversion that is not tabu
+// and does not lead back to a visited tour, unless it beats the shared best (aspiration)
+// Returns 1 and the change in distance when a move was made, 0 when every candidate was rejected
+int tabu_step(Tour *tour, TabuState *tabu, int iteration, int distance, int *delta)
+{
+    if (num_cities < 4)
+    {
+        return 0;
+    }
+
+    int best_a = 0, best_b = 0;
+    int best_inversion = 0;
+    int best_delta = INT_MAX;
+    unsigned long long best_hash = 0;
+    int best_aspiration = 0;
+
+    for (int k = 0; k < TABU_CANDIDATES; ++k)
+    {
+        // Sample a random exchange of a and b, or on symmetric matrices an inversion of the path a..b
+        int inversion = matrix_symmetric && (k & 1);
+        int a = active_cities[rand() % num_cities];
+        int b = active_cities[rand() % num_cities];
+        int candidate_delta;
+        unsigned long long hash_delta;
+        if (inversion)
+        {
+            int before = tour_prev(tour, a);
+            int after = tour_next(tour, b);
+            if (a == b || after == a || before == b)
+            {
+                continue;
+            }
+            candidate_delta = get_distance(before, b) + get_distance(a, after) - get_distance(before, a) - get_distance(b, after);
+            hash_delta = edge_key(before, a) ^ edge_key(b, after) ^ edge_key(before, b) ^ edge_key(a, after);
+        }
+        else
+        {
+            if (a == b)
+            {
+                continue;
+            }
+            candidate_delta = core_exchange_delta(&context, tour, a, b);
+            hash_delta = exchange_hash_delta(tour, a, b);
+        }
+        if (candidate_delta >= best_delta)
+        {
+            continue;
+        }
+        unsigned long long candidate_hash = tabu->hash ^ hash_delta;
+
+        // A move that beats the shared best is always allowed
+        int aspiration = distance + candidate_delta < shared_memory->distance;
+        if (!aspiration && (tabu->tabu_until[a] > iteration || tabu->tabu_until[b] > iteration))
+        {
+            tabu->stats.tabu_rejected++;
+            continue;
+        }
+        if (!aspiration && tabu_visited(tabu, candidate_hash))
+        {
+            tabu->stats.repeats_skipped++;
+            continue;
+        }
+
+        best_a = a;
+        best_b = b;
+        best_inversion = inversion;
+        best_delta = candidate_delta;
+        best_hash = candidate_hash;
+        best_aspiration = aspiration;
+    }
+
+    if (best_delta == INT_MAX)
+    {
+        return 0;
+    }
+
+    // Make the move and forbid moving both cities again for the tenure of this worker
+    if (best_inversion)
+    {
+        tour_reverse(tour, best_a, best_b);
+    }
+    else
+    {
+        tour_swap(tour, best_a, best_b);
+    }
+    tabu->hash = best_hash;
+    tabu_remember(tabu, best_hash);
+    tabu->tabu_until[best_a] = iteration + tabu->tenure;
+    tabu->tabu_until[best_b] = iteration + tabu->tenure;
+    tabu->stats.moves++;
+    tabu->stats.aspirations += best_aspiration;
+
+    *delta = best_delta;
+    return 1;
+}
+
+// Function to apply a segment kick to a path: restart a random run of cities in random order
+void segment_kick(int *path)
+{
+    int max_length = num_cities < KICK_SEGMENT_MAX ? num_cities : KICK_SEGMENT_MAX;
+    int min_length = max_length < KICK_SEGMENT_MIN ? max_length : KICK_SEGMENT_MIN;
+    int length = min_length + rand() % (max_length - min_length + 1);
+    int start = rand() % (num_cities - length + 1);
+
+    for (int i = length - 1; i > 0; --i)
+    {
+        int j = rand() % (i + 1);
+        int temp = path[start + i];
+        path[start + i] = path[start + j];
+        path[start + j] = temp;
+    }
+}
+
+// Function to decide whether the local optimum just reached replaces the incumbent of the iterated local search
+int accept_local_optimum(int distance, int incumbent)
+{
+    switch (accept_criterion)
+    {
+    case ACCEPT_ALWAYS:
+        return 1;
+    case ACCEPT_THRESHOLD:
+        return distance <= incumbent * (1.0 + accept_threshold / 100.0);
+    default:
+        return distance <= incumbent;
+    }
+}
+
+// Function to end one round of the iterated local search: accept or reject the local optimum
+// in the tour, then kick the incumbent out of its basin so the operators can re-optimize it
+void ils_kick(Tour *tour, IlsState *ils, int *path, int *distance)
+{
+    tour_to_path(tour, path);
+    ils->stats.kicks++;
+    if (*distance < ils->distance)
+    {
+        ils->stats.improved++;
+    }
+
+    // The first local optimum is always accepted
+    if (ils->distance == INT_MAX || accept_local_optimum(*distance, ils->distance))
+    {
+        memcpy(ils->path, path, num_cities * sizeof(int));
+        ils->distance = *distance;
+        ils->stats.accepted++;
+    }
+    else
+    {
+        memcpy(path, ils->path, num_cities * sizeof(int));
+    }
+
+    if (kick_type == KICK_SEGMENT)
+    {
+        segment_kick(path);
+    }
+    else
+    {
+        core_double_bridge_kick(&context, path);
+    }
+    *distance = calculate_distance(path);
+    tour_load(tour, path, num_cities);
+}
+
+// Function to get the elapsed time in milliseconds
+long get_elapsed_time()
+{
+    // Get the current time
+    struct timeval current_time;
+    gettimeofday(&current_time, NULL);
+
+    // Calculate the elapsed time in microseconds
+    long elapsed_time = (current_time.tv_sec - start_program_time.tv_sec) * 1000000 +
+                        (current_time.tv_usec - start_program_time.tv_usec);
+
+    // Convert elapsed time to milliseconds
+    return elapsed_time / 1000;
+}
+
+// Function to record an improvement of the shared best on an updated instance, called under the semaphore
+// The log only keeps improvements of at least RECOVERY_STEP percent, so long runs fit in it
+void record_best_event(int distance)
+{
+    int index = instance_version / 2 - 1;
+    if (index >= MAX_UPDATES)
+    {
+        return;
+    }
+
+    UpdateRecord *record = &shared_segment->updates[index];
+    long now = get_elapsed_time();
+    if (record->first_distance == 0)
+    {
+        record->first_distance = distance;
+        record->first_time = now;
+    }
+    record->last_distance = distance;
+    record->last_time = now;
+
+    if ((record->kept_distance == 0 || distance <= record->kept_distance * (1.0 - RECOVERY_STEP / 100.0)) &&
+        shared_segment->num_best_events < MAX_BEST_EVENTS)
+    {
+        BestEvent *event = &shared_segment->best_events[shared_segment->num_best_events++];
+        event->time = now;
+        event->distance = distance;
+        event->instance_version = instance_version;
+        record->kept_distance = distance;
+    }
+}
+
+// Function to update shared memory with a new solution
+void update_shared_memory(Solution *solution)
+{
+    // Wait for the semaphore to access shared memory
+    sem_wait(semaphore);
+
+    // Update the shared memory if the new solution is shorter and was found on the current instance,
+    // copying only the cities of the instance while the other workers wait for the semaphore
+    if (instance_version == shared_segment->instance_version &&
+        core_replace_best(&context, shared_memory->path, &shared_memory->distance, solution->path, solution->distance))
+    {
+        shared_memory->total_iterations = solution->total_iterations;
+        shared_memory->process_id = solution->process_id;
+
+        // Keep the improvement for the report on how quality recovers after updates
+        if (updates_path != NULL && instance_version > 0)
+        {
+            record_best_event(solution->distance);
+        }
+
+        // Stop every worker if the new best is good enough
+        check_stop_criteria(solution->distance);
+    }
+
+    // Release the semaphore
+    sem_post(semaphore);
+}
+
+// Function to copy the shared best tour into a worker when it is shorter than the worker's tour
+// Returns whether the tour was adopted; tours of an older instance are never adopted
+int adopt_shared_best(int *path, int *distance)
+{
+    int adopted = 0;
+
+    // Wait for the semaphore to access shared memory
+    sem_wait(semaphore);
+    if (shared_memory->distance < *distance && instance_version == shared_segment->instance_version)
+    {
+        memcpy(path, shared_memory->path, num_cities * sizeof(int));
+        *distance = shared_memory->distance;
+        adopted = 1;
+    }
+    sem_post(semaphore);
+
+    return adopted;
+}
+
+// Function to publish the tour of a worker when it beats the shared best, and to record the best time
+void publish_solution(Tour *tour, Solution *solution)
+{
+    // Update the shared memory if the current solution is better
+    if (solution->distance < shared_memory->distance)
+    {
+        tour_to_path(tour, solution->path);
+        update_shared_memory(solution);
+    }
+
+    // Check if the current solution is the best
+    if (solution->distance < best_solution.distance)
+    {
+        best_solution.distance = solution->distance;
+
+        // Update the best time
+        gettimeofday(current_time, NULL);
+    }
+}
+
+// Function to get how far apart two cities numbered from 0 are, in both directions
+long long cluster_dissimilarity(int a, int b)
+{
+    return (long long)distance_matrix[a * matrix_stride + b] + distance_matrix[b * matrix_stride + a];
+}
+
+// Function to move the medoid of a cluster to the member with the smallest total dissimilarity to the others
+void update_cluster_medoid(int cluster)
+{
+    long long best_total = LLONG_MAX;
+    for (int i = cluster_start[cluster]; i < cluster_start[cluster + 1]; ++i)
+    {
+        long long total = 0;
+        for (int j = cluster_start[cluster]; j < cluster_start[cluster + 1] && total < best_total; ++j)
+        {
+            total += cluster_dissimilarity(cluster_cities[i] - 1, cluster_cities[j] - 1);
+        }
+        if (total < best_total)
+        {
+            best_total = total;
+            cluster_medoid[cluster] = cluster_cities[i] - 1;
+        }
+    }
+}
+
+// Function to partition the cities into k clusters with k-medoids on the distance matrix
+// Medoids are seeded k-means++ style and refined by alternating assignment and medoid updates
+void build_clusters(int k)
+{
+    int *cluster_of = malloc(num_cities * sizeof(int));
+    double *weight = malloc(num_cities * sizeof(double));
+    int *count = calloc(k, sizeof(int));
+    if (cluster_of == NULL || weight == NULL || count == NULL)
+    {
+        perror("Error allocating clusters");
+        exit(EXIT_FAILURE);
+    }
+
+    // Draw every next medoid with a probability proportional to its squared dissimilarity to the closest medoid
+    cluster_medoid[0] = rand() % num_cities;
+    for (int i = 0; i < num_cities; ++i)
+    {
+        weight[i] = INFINITY;
+    }
+    for (int c = 1; c < k; ++c)
+    {
+        double total = 0.0;
+        for (int i = 0; i < num_cities; ++i)
+        {
+            double d = (double)cluster_dissimilarity(i, cluster_medoid[c - 1]);
+            if (i == cluster_medoid[c - 1] || d * d < weight[i])
+            {
+                weight[i] = i == cluster_medoid[c - 1] ? 0.0 : d * d;
+            }
+            total += weight[i];
+        }
+
+        // Medoids have no weight; rounding may run past the last city and cities that coincide
+        // with a medoid have no weight either, so fall back to any city that is not a medoid
+        double r = total * rand() / ((double)RAND_MAX + 1.0);
+        int chosen = -1;
+        for (int i = 0; i < num_cities && chosen == -1; ++i)
+        {
+            if (weight[i] > 0.0 && r < weight[i])
+            {
+                chosen = i;
+            }
+            r -= weight[i];
+        }
+        for (int i = num_cities - 1; i >= 0 && chosen == -1; --i)
+        {
+            int is_medoid = 0;
+            for (int m = 0; m < c; ++m)
+            {
+                is_medoid |= cluster_medoid[m] == i;
+            }
+            if (!is_medoid)
+            {
+                chosen = i;
+            }
+        }
+        cluster_medoid[c] = chosen;
+    }
+
+    for (int iteration = 0; iteration < KMEDOIDS_ITERATIONS; ++iteration)
+    {
+        // Assign every city to its closest medoid; a medoid always stays in its own cluster
+        memset(count, 0, k * sizeof(int));
+        for (int i = 0; i < num_cities; ++i)
+        {
+            int best = 0;
+            long long best_dissimilarity = LLONG_MAX;
+            for (int c = 0; c < k; ++c)
+            {
+                long long d = cluster_medoid[c] == i ? -1 : cluster_dissimilarity(i, cluster_medoid[c]);
+                if (d < best_dissimilarity)
+                {
+                    best_dissimilarity = d;
+                    best = c;
+                }
+            }
+            cluster_of[i] = best;
+            count[best]++;
+        }
+
+        // Group the cities by cluster
+        cluster_start[0] = 0;
+        for (int c = 0; c < k; ++c)
+        {
+            cluster_start[c + 1] = cluster_start[c] + count[c];
+            count[c] = cluster_start[c];
+        }
+        for (int i = 0; i < num_cities; ++i)
+        {
+            cluster_cities[count[cluster_of[i]]++] = i + 1;
+        }
+
+        // Move every medoid to the member with the smallest total dissimilarity to the others
+        int changed = 0;
+        for (int c = 0; c < k; ++c)
+        {
+            int previous = cluster_medoid[c];
+            update_cluster_medoid(c);
+            changed |= previous != cluster_medoid[c];
+        }
+        if (!changed)
+        {
+            break;
+        }
+    }
+
+    free(cluster_of);
+    free(weight);
+    free(count);
+}
+
+// Function to split every cluster larger than HELD_KARP_MAX_CITIES in two until all of them can be solved exactly
+// A cluster is split around its medoid and the member farthest from it, every other member joining the closer one
+void split_large_clusters()
+{
+    int *buffer = malloc(num_cities * sizeof(int));
+    if (buffer == NULL)
+    {
+        perror("Error allocating clusters");
+        exit(EXIT_FAILURE);
+    }
+
+    int c = 0;
+    while (c < num_clusters)
+    {
+        int start = cluster_start[c];
+        int m = cluster_start[c + 1] - start;
+        if (m <= HELD_KARP_MAX_CITIES)
+        {
+            c++;
+            continue;
+        }
+
+        // Seed the halves with the medoid and the member farthest from it; both halves are never empty
+        int a = cluster_medoid[c];
+        int b = -1;
+        long long farthest = -1;
+        for (int i = start; i < start + m; ++i)
+        {
+            long long d = cluster_dissimilarity(a, cluster_cities[i] - 1);
+            if (cluster_cities[i] - 1 != a && d > farthest)
+            {
+                farthest = d;
+                b = cluster_cities[i] - 1;
+            }
+        }
+
+        // Write the members closer to a first and the members closer to b after them
+        int first = 0;
+        int second = m;
+        for (int i = start; i < start + m; ++i)
+        {
+            int city = cluster_cities[i] - 1;
+            int to_a = city != b && (city == a || cluster_dissimilarity(city, a) <= cluster_dissimilarity(city, b));
+            if (to_a)
+            {
+                buffer[first++] = city + 1;
+            }
+            else
+            {
+                buffer[--second] = city + 1;
+            }
+        }
+        memcpy(&cluster_cities[start], buffer, m * sizeof(int));
+
+        // Insert the second half as a new cluster right after this one
+        for (int i = num_clusters; i > c; --i)
+        {
+            cluster_start[i + 1] = cluster_start[i];
+            cluster_medoid[i] = cluster_medoid[i - 1];
+        }
+        cluster_start[c + 1] = start + first;
+        num_clusters++;
+        update_cluster_medoid(c);
+        update_cluster_medoid(c + 1);
+    }
+
+    free(buffer);
+}
+
+// Function to build a closed tour through some cities by always moving to the nearest unvisited one
+void nearest_neighbour_tour(const int *cities, int m, int *tour)
+{
+    memcpy(tour, cities, m * sizeof(int));
+    for (int i = 1; i < m; ++i)
+    {
+        int nearest = i;
+        for (int j = i + 1; j < m; ++j)
+        {
+            if (get_distance(tour[i - 1], tour[j]) < get_distance(tour[i - 1], tour[nearest]))
+            {
+                nearest = j;
+            }
+        }
+        int temp = tour[i];
+        tour[i] = tour[nearest];
+        tour[nearest] = temp;
+    }
+}
+
+// Function to improve a closed tour through some cities with 2-opt and or-opt until no move helps
+// Prefix sums of the edges in both directions give the cost of a reversed run in constant time,
+// so 2-opt is exact on asymmetric matrices too
+void improve_cluster_tour(int *tour, int m, time_t start_time, int max_time)
+{
+    long long *forward = malloc(m * sizeof(long long));
+    long long *backward = malloc(m * sizeof(long long));
+    int *buffer = malloc(m * sizeof(int));
+    if (forward == NULL || backward == NULL || buffer == NULL)
+    {
+        perror("Error allocating cluster tour");
+        exit(EXIT_FAILURE);
+    }
+
+    int improved = 1;
+    while (improved && *stop_reason == STOP_NONE && difftime(time(NULL), start_time) < max_time)
+    {
+        improved = 0;
+
+        // 2-opt: reverse tour[i..j], keeping tour[0] in place
+        for (int i = 1; i < m - 1; ++i)
+        {
+            forward[0] = backward[0] = 0;
+            for (int t = 1; t < m; ++t)
+            {
+                forward[t] = forward[t - 1] + get_distance(tour[t - 1], tour[t]);
+                backward[t] = backward[t - 1] + get_distance(tour[t], tour[t - 1]);
+            }
+            for (int j = i + 1; j < m; ++j)
+            {
+                int before = tour[i - 1];
+                int after = tour[(j + 1) % m];
+                long long delta = get_distance(before, tour[j]) + get_distance(tour[i], after) -
+                                  get_distance(before, tour[i]) - get_distance(tour[j], after) +
+                                  (backward[j] - backward[i]) - (forward[j] - forward[i]);
+                if (delta < 0)
+                {
+                    for (int a = i, b = j; a < b; ++a, --b)
+                    {
+                        int temp = tour[a];
+                        tour[a] = tour[b];
+                        tour[b] = temp;
+                    }
+                    improved = 1;
+                    break;
+                }
+            }
+        }
+
+        // Or-opt: move a run of up to OR_OPT_MAX cities, in the same direction, between two other cities
+        for (int length = 1; length <= OR_OPT_MAX && length < m - 1; ++length)
+        {
+            for (int s = 1; s + length <= m; ++s)
+            {
+                int e = s + length - 1;
+                int before = tour[s - 1];
+                int after = tour[(e + 1) % m];
+                int removed = get_distance(before, after) - get_distance(before, tour[s]) - get_distance(tour[e], after);
+                for (int p = 0; p < m; ++p)
+                {
+                    int q = (p + 1) % m;
+                    if ((p >= s - 1 && p <= e) || q == s)
+                    {
+                        continue;
+                    }
+                    int delta = removed + get_distance(tour[p], tour[s]) + get_distance(tour[e], tour[q]) -
+                                get_distance(tour[p], tour[q]);
+                    if (delta < 0)
+                    {
+                        // Rebuild the tour without the run, then put the run back after tour[p]
+                        int count = 0;
+                        for (int t = 0; t < m; ++t)
+                        {
+                            if (t < s || t > e)
+                            {
+                                buffer[count++] = tour[t];
+                            }
+                            if (t == p)
+                            {
+                                memcpy(&buffer[count], &tour[s], length * sizeof(int));
+                                count += length;
+                            }
+                        }
+                        memcpy(tour, buffer, m * sizeof(int));
+                        improved = 1;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    free(forward);
+    free(backward);
+    free(buffer);
+}
+
+// Function to join the cluster sub-tours into one tour, visiting the clusters in nearest-neighbour
+// order of their medoids and entering every cluster where it costs the least
+void stitch_clusters()
+{
+    int *order = malloc(num_clusters * sizeof(int));
+    int *path = malloc(num_cities * sizeof(int));
+    if (order == NULL || path == NULL)
+    {
+        perror("Error allocating stitched tour");
+        exit(EXIT_FAILURE);
+    }
+
+    // Order the clusters by walking from every medoid to the closest medoid not yet visited
+    for (int c = 0; c < num_clusters; ++c)
+    {
+        order[c] = c;
+    }
+    for (int i = 1; i < num_clusters; ++i)
+    {
+        int nearest = i;
+        for (int j = i + 1; j < num_clusters; ++j)
+        {
+            if (cluster_dissimilarity(cluster_medoid[order[i - 1]], cluster_medoid[order[j]]) <
+                cluster_dissimilarity(cluster_medoid[order[i - 1]], cluster_medoid[order[nearest]]))
+            {
+                nearest = j;
+            }
+        }
+        int temp = order[i];
+        order[i] = order[nearest];
+        order[nearest] = temp;
+    }
+
+    // Open every sub-tour at the edge and in the direction that connects best to the previous cluster
+    int length = 0;
+    for (int i = 0; i < num_clusters; ++i)
+    {
+        int *sub = &shared_segment->cluster_tours[cluster_start[order[i]]];
+        int m = cluster_start[order[i] + 1] - cluster_start[order[i]];
+        if (i == 0 || m == 1)
+        {
+            memcpy(&path[length], sub, m * sizeof(int));
+            length += m;
+            continue;
+        }
+
+        // Reading the sub-tour backwards changes its length on asymmetric matrices
+        long long reverse_extra = 0;
+        for (int t = 0; t < m; ++t)
+        {
+            reverse_extra += get_distance(sub[(t + 1) % m], sub[t]) - get_distance(sub[t], sub[(t + 1) % m]);
+        }
+
+        int exit_city = path[length - 1];
+        long long best_cost = LLONG_MAX;
+        int best_edge = 0;
+        int best_backward = 0;
+        for (int e = 0; e < m; ++e)
+        {
+            int a = sub[e];
+            int b = sub[(e + 1) % m];
+            long long forward_cost = get_distance(exit_city, b) - get_distance(a, b);
+            long long backward_cost = get_distance(exit_city, a) - get_distance(b, a) + reverse_extra;
+            if (forward_cost < best_cost)
+            {
+                best_cost = forward_cost;
+                best_edge = e;
+                best_backward = 0;
+            }
+            if (backward_cost < best_cost)
+            {
+                best_cost = backward_cost;
+                best_edge = e;
+                best_backward = 1;
+            }
+        }
+        for (int t = 0; t < m; ++t)
+        {
+            path[length++] = best_backward ? sub[(best_edge - t + m) % m] : sub[(best_edge + 1 + t) % m];
+        }
+    }
+
+    // Leave the stitched tour where every worker can load it
+    memcpy(shared_segment->cluster_tours, path, num_cities * sizeof(int));
+    shared_segment->stitched_distance = calculate_distance(path);
+    shared_segment->stitch_time = get_elapsed_time();
+    __sync_synchronize();
+    shared_segment->cluster_stitched = 1;
+
+    free(order);
+    free(path);
+}
+
+// Function to bring the tour of a worker to the current instance after an update: cities that left
+// are cut out, new cities are inserted where they cost the least and the distance is recomputed
+// Returns 0 when the parent is still updating the instance, so the worker tries again later
+int repair_tour(Tour *tour, int *path, int *distance)
+{
+    // Copy the city set between two reads of an even version, like reading an elite slot
+    int version = __atomic_load_n(&shared_segment->instance_version, __ATOMIC_ACQUIRE);
+    if (version & 1)
+    {
+        return 0;
+    }
+
+    // Cities added since the tour was built may reuse the number of a removed city, so they are only kept
+    // when their number was given out no later than the version of the tour
+    int count = shared_segment->active_count;
+    int *cities = malloc(count * sizeof(int));
+    char *active = calloc(matrix_stride + 1, 1);
+    char *in_tour = calloc(matrix_stride + 1, 1);
+    memcpy(cities, shared_segment->active, count * sizeof(int));
+    for (int i = 0; i < count; ++i)
+    {
+        active[cities[i]] = shared_segment->city_added[cities[i]] <= instance_version;
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&shared_segment->instance_version, __ATOMIC_RELAXED) != version)
+    {
+        free(cities);
+        free(active);
+        free(in_tour);
+        return 0;
+    }
+
+    // Keep the cities of the tour that are still in the instance, in tour order
+    tour_to_path(tour, path);
+    int length = 0;
+    for (int i = 0; i < num_cities; ++i)
+    {
+        if (active[path[i]])
+        {
+            path[length++] = path[i];
+            in_tour[path[i]] = 1;
+        }
+    }
+
+    // Insert every new city after the city where it lengthens the tour the least
+    for (int i = 0; i < count; ++i)
+    {
+        int city = cities[i];
+        if (in_tour[city])
+        {
+            continue;
+        }
+        int best = length - 1;
+        long long best_cost = LLONG_MAX;
+        for (int k = 0; k < length && length > 1; ++k)
+        {
+            int next = path[(k + 1) % length];
+            long long cost = (long long)get_distance(path[k], city) + get_distance(city, next) - get_distance(path[k], next);
+            if (cost < best_cost)
+            {
+                best_cost = cost;
+                best = k;
+            }
+        }
+        memmove(&path[best + 2], &path[best + 1], (length - best - 1) * sizeof(int));
+        path[best + 1] = city;
+        length++;
+    }
+
+    num_cities = count;
+    memcpy(active_cities, cities, count * sizeof(int));
+    update_context();
+    instance_version = version;
+    tour_load(tour, path, num_cities);
+    *distance = calculate_distance(path);
+
+    free(cities);
+    free(active);
+    free(in_tour);
+    return 1;
+}
+
+// Function to solve the clusters claimed by a worker, exactly when they are small enough
+// The worker that completes the last cluster stitches the sub-tours together
+void solve_clusters(time_t start_time, int max_time)
+{
+    int *tour = malloc(num_cities * sizeof(int));
+    if (tour == NULL)
+    {
+        perror("Error allocating cluster tour");
+        exit(EXIT_FAILURE);
+    }
+
+    int cluster;
+    while ((cluster = __sync_fetch_and_add(&shared_segment->cluster_next, 1)) < num_clusters)
+    {
+        int *cities = &cluster_cities[cluster_start[cluster]];
+        int m = cluster_start[cluster + 1] - cluster_start[cluster];
+        if (m <= HELD_KARP_MAX_CITIES)
+        {
+            if (core_held_karp_tour(&context, cities, m, tour) == -1)
+            {
+                perror("Error allocating Held-Karp table");
+                exit(EXIT_FAILURE);
+            }
+            __sync_fetch_and_add(&shared_segment->clusters_exact, 1);
+        }
+        else
+        {
+            nearest_neighbour_tour(cities, m, tour);
+            improve_cluster_tour(tour, m, start_time, max_time);
+        }
+        memcpy(&shared_segment->cluster_tours[cluster_start[cluster]], tour, m * sizeof(int));
+
+        if (__sync_add_and_fetch(&shared_segment->clusters_done, 1) == num_clusters)
+        {
+            stitch_clusters();
+        }
+    }
+
+    free(tour);
+}
+
+// Function to run the algorithm
+void run_algorithm(int process_id, int num_processes, int max_time)
+{
+    // Local variables for the current process
+    Solution current_solution;
+    int iteration = 0;
+    time_t start_time = time(NULL);
+    srand((unsigned int)time(NULL) ^ (unsigned int)getpid());
+    context.seed = (unsigned int)rand();
+
+    // Run on the CPUs of this worker's NUMA node and read its local copy of the matrix
+    if (use_numa)
+    {
+        bind_worker_to_node(process_id);
+    }
+
+    // Stagnation tracking of this process, in moves and in milliseconds
+    int last_improvement = 0;
+    long last_improvement_time = get_elapsed_time();
+    int restarts = 0;
+
+    // Operator selection state of this process
+    OperatorBandit bandit;
+    memset(&bandit, 0, sizeof(bandit));
+
+    // Tabu search state of this process; tenures differ per worker so they explore different regions
+    TabuState tabu;
+    memset(&tabu, 0, sizeof(tabu));
+    if (search_mode == MODE_TABU)
+    {
+        tabu.tabu_until = calloc(matrix_stride + 1, sizeof(int));
+        tabu.visited = calloc(TABU_VISITED_SIZE, sizeof(unsigned long long));
+        if (tabu.tabu_until == NULL || tabu.visited == NULL)
+        {
+            perror("Error allocating tabu memory");
+            exit(EXIT_FAILURE);
+        }
+        tabu.tenure = tabu_tenure + tabu_tenure * process_id / num_processes;
+    }
+
+    // Iterated local search state of this process; the incumbent has room for the cities updates may add
+    IlsState ils;
+    memset(&ils, 0, sizeof(ils));
+    ils.distance = INT_MAX;
+    if (search_mode == MODE_ILS)
+    {
+        ils.path = malloc(matrix_stride * sizeof(int));
+        if (ils.path == NULL)
+        {
+            perror("Error allocating iterated local search memory");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // In decomposition mode, solve clusters until none are left and start from the stitched tour
+    // once every cluster is done; otherwise start from a random path
+    int stitched = 0;
+    if (num_clusters > 0)
+    {
+        solve_clusters(start_time, max_time);
+        while (!shared_segment->cluster_stitched && *stop_reason == STOP_NONE &&
+               difftime(time(NULL), start_time) < max_time)
+        {
+            usleep(1000);
+        }
+        __sync_synchronize();
+        stitched = shared_segment->cluster_stitched;
+    }
+    if (stitched)
+    {
+        memcpy(current_solution.path, shared_segment->cluster_tours, num_cities * sizeof(int));
+    }
+    else
+    {
+        core_random_path(&context, current_solution.path);
+    }
+
+    // Represent the tour as a two-level list on large instances and as an array otherwise
+    Tour tour;
+    if (tour_init(&tour, current_solution.path, num_cities, matrix_stride, use_tour_list) == -1)
+    {
+        perror("Error allocating tour");
+        exit(EXIT_FAILURE);
+    }
+    current_solution.distance = calculate_tour_distance(&tour);
+
+    current_solution.process_id = process_id; // Set process_id
+    current_solution.total_iterations = 0;    // Initialize total iterations
+    int local_best = current_solution.distance;
+    tabu.hash = calculate_path_hash(current_solution.path);
+
+    // Publish the starting tour, which may already be a local optimum
+    update_shared_memory(&current_solution);
+
+    // Main loop for the genetic algorithm
+    while (difftime(time(NULL), start_time) < max_time)
+    {
+        // Quit as soon as any worker has met a stopping criterion
+        if (*stop_reason != STOP_NONE)
+        {
+            break;
+        }
+
+        // After an instance update, repair the current tour and keep optimizing it instead of restarting
+        if (updates_path != NULL && __atomic_load_n(&shared_segment->instance_version, __ATOMIC_RELAXED) != instance_version &&
+            repair_tour(&tour, current_solution.path, &current_solution.distance))
+        {
+            // Searches remember tours of the old instance, which no longer exist
+            ils.distance = INT_MAX;
+            if (search_mode == MODE_TABU)
+            {
+                memset(tabu.visited, 0, TABU_VISITED_SIZE * sizeof(unsigned long long));
+                tabu.visited_count = 0;
+                tabu.hash = calculate_path_hash(current_solution.path);
+            }
+            last_improvement = iteration;
+            last_improvement_time = get_elapsed_time();
+            local_best = current_solution.distance;
+            update_shared_memory(&current_solution);
+        }
+
+        // When the tour has stopped improving for too many moves or too long, store it in the elite archive
+        // and then either kick it (iterated local search), restart from an elite member or from a
+        // relinked tour between two members, or without an archive continue from the shared best tour
+        long now = get_elapsed_time();
+        if (iteration - last_improvement >= stagnation_limit ||
+            (stagnation_time > 0 && now - last_improvement_time >= stagnation_time))
+        {
+            tour_to_path(&tour, current_solution.path);
+            if (elite_size > 0)
+            {
+                elite_insert(current_solution.path, current_solution.distance);
+            }
+            if (search_mode == MODE_ILS)
+            {
+                ils_kick(&tour, &ils, current_solution.path, &current_solution.distance);
+            }
+            else if (elite_size > 0 ? restart_from_elite(current_solution.path, &current_solution.distance)
+                                    : adopt_shared_best(current_solution.path, &current_solution.distance))
+            {
+                tour_load(&tour, current_solution.path, num_cities);
+                tabu.hash = calculate_path_hash(current_solution.path);
+                restarts++;
+            }
+            last_improvement = iteration;
+            last_improvement_time = now;
+            local_best = current_solution.distance;
+        }
+
+        if (search_mode == MODE_TABU)
+        {
+            // Make a batch of tabu moves, which may also lengthen the tour
+            for (int move = 0; move < OPERATOR_BATCH; ++move)
+            {
+                int delta;
+                if (!tabu_step(&tour, &tabu, iteration + move, current_solution.distance, &delta))
+                {
+                    continue;
+                }
+                current_solution.distance += delta;
+
+                // Publish every new best tour of this walk, it may be left on the next move
+                if (current_solution.distance < local_best)
+                {
+                    local_best = current_solution.distance;
+                    last_improvement = iteration + move;
+                    last_improvement_time = get_elapsed_time();
+                    current_solution.total_iterations = iteration + move;
+                    publish_solution(&tour, &current_solution);
+                }
+            }
+            iteration += OPERATOR_BATCH;
+            current_solution.total_iterations = iteration;
+            continue;
+        }
+
+        // Pick the mutation operator for the next batch of moves
+        int op = select_operator(&bandit);
+        int gain = 0;
+        int improvements = 0;
+        struct timespec batch_start, batch_end;
+        clock_gettime(CLOCK_MONOTONIC, &batch_start);
+
+        // Apply the operator, which keeps a move only when it shortens the tour
+        for (int move = 0; move < OPERATOR_BATCH; ++move)
+        {
+            int delta = mutation_operators[op].mutate(&tour);
+            if (delta < 0)
+            {
+                gain -= delta;
+                improvements++;
+            }
+        }
+
+        // Reward the operator with its improvement per unit of time
+        clock_gettime(CLOCK_MONOTONIC, &batch_end);
+        long time_ns = (batch_end.tv_sec - batch_start.tv_sec) * 1000000000L + (batch_end.tv_nsec - batch_start.tv_nsec);
+        record_operator_batch(&bandit, op, OPERATOR_BATCH, improvements, gain, time_ns);
+
+        // Increment the iteration counter and update total iterations
+        iteration += OPERATOR_BATCH;
+        current_solution.total_iterations = iteration;
+
+        // Nothing else changes when every move was rejected
+        if (gain == 0)
+        {
+            continue;
+        }
+        current_solution.distance -= gain;
+        last_improvement = iteration;
+        last_improvement_time = get_elapsed_time();
+        publish_solution(&tour, &current_solution);
+    }
+
+    // Report the operator statistics and restarts of this process to the parent
+    memcpy(shared_segment->operator_stats[process_id], bandit.stats, sizeof(bandit.stats));
+    shared_segment->restarts[process_id] = restarts;
+    shared_segment->tabu_stats[process_id] = tabu.stats;
+    shared_segment->ils_stats[process_id] = ils.stats;
+
+    // Leave the final tour in the elite archive
+    if (elite_size > 0)
+    {
+        tour_to_path(&tour, current_solution.path);
+        elite_insert(current_solution.path, current_solution.distance);
+    }
+
+    // Release the tour and tabu memory of this process
+    tour_free(&tour);
+    free(tabu.tabu_until);
+    free(tabu.visited);
+    free(ils.path);
+}
+
+// Function to compute the checksum of the distance matrix (FNV-1a over its entries)
+uint32_t calculate_matrix_checksum()
+{
+    uint32_t checksum = 2166136261u;
+    for (long i = 0; i < (long)matrix_stride * matrix_stride; ++i)
+    {
+        checksum = (checksum ^ (uint32_t)distance_matrix[i]) * 16777619u;
+    }
+    return checksum;
+}
+
+// Function to send as much of the queued message of a peer as the socket accepts without blocking
+// Returns -1 when the connection is lost
+int flush_peer(Peer *peer)
+{
+    while (peer->outbox_sent < peer->outbox_size)
+    {
+        ssize_t written = send(peer->fd, peer->outbox + peer->outbox_sent, peer->outbox_size - peer->outbox_sent,
+                               MSG_NOSIGNAL);
+        if (written == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        if (written <= 0)
+        {
+            return -1;
+        }
+        peer->outbox_sent += written;
+        peer->last_progress = get_elapsed_time();
+    }
+    return 0;
+}
+
+// Function to queue a message header followed by its entries, all in network byte order, and start sending it
+// Returns 1 without queuing when the previous message has not been sent yet, -1 when the connection is lost
+int send_message(Peer *peer, int type, int distance, const uint32_t *entries, uint32_t count)
+{
+    if (peer->outbox_sent < peer->outbox_size)
+    {
+        return 1;
+    }
+
+    NetHeader header = {htonl(type), htonl(num_cities), htonl(matrix_checksum), htonl(distance), htonl(lower_bound),
+                        htonl(count)};
+    memcpy(peer->outbox, &header, sizeof(header));
+    if (count > 0)
+    {
+        memcpy(peer->outbox + sizeof(header), entries, count * sizeof(uint32_t));
+    }
+    peer->outbox_size = sizeof(header) + count * sizeof(uint32_t);
+    peer->outbox_sent = 0;
+    peer->last_progress = get_elapsed_time();
+    net_stats.bytes_sent += peer->outbox_size;
+    return flush_peer(peer);
+}
+
+// Function to add a connected socket as a peer and greet it
+void add_peer(int fd)
+{
+    if (num_peers == MAX_PEERS)
+    {
+        close(fd);
+        return;
+    }
+
+    // Tours are small and latency matters more than batching; the supervise loop must never block on a peer
+    int enabled = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+    // Both buffers hold the largest message, a full tour
+    size_t message_size = sizeof(NetHeader) + num_cities * sizeof(uint32_t);
+    Peer *peer = &peers[num_peers];
+    memset(peer, 0, sizeof(*peer));
+    peer->fd = fd;
+    peer->sent = malloc(num_cities * sizeof(int));
+    peer->received = malloc(num_cities * sizeof(int));
+    peer->inbox = malloc(message_size);
+    peer->outbox = malloc(message_size);
+    peer->sent_distance = INT_MAX;
+    peer->received_distance = INT_MAX;
+    peer->tokens = net_bandwidth;
+    if (peer->sent == NULL || peer->received == NULL || peer->inbox == NULL || peer->outbox == NULL ||
+        send_message(peer, NET_HELLO, INT_MAX, NULL, 0) == -1)
+    {
+        free(peer->sent);
+        free(peer->received);
+        free(peer->inbox);
+        free(peer->outbox);
+        close(fd);
+        return;
+    }
+    num_peers++;
+    net_stats.peers_seen++;
+}
+
+// Function to drop a peer whose connection was lost or refused
+void remove_peer(int index)
+{
+    close(peers[index].fd);
+    free(peers[index].sent);
+    free(peers[index].received);
+    free(peers[index].inbox);
+    free(peers[index].outbox);
+    peers[index] = peers[--num_peers];
+}
+
+// Function to drop the peers whose connection failed or whose half-sent or half-received message stalled
+void drop_stalled_peers()
+{
+    long now = get_elapsed_time();
+    for (int i = num_peers - 1; i >= 0; --i)
+    {
+        Peer *peer = &peers[i];
+        int pending = peer->inbox_used > 0 || peer->outbox_sent < peer->outbox_size;
+        if (!peer->lost && pending && now - peer->last_progress >= NET_TIMEOUT)
+        {
+            fprintf(stderr, "Dropping a peer that stalled for %d ms\n", NET_TIMEOUT);
+            net_stats.stalled++;
+            peer->lost = 1;
+        }
+        if (peer->lost)
+        {
+            remove_peer(i);
+        }
+    }
+}
+
+// Function to open the port the worker instances connect to
+void start_coordinator()
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(listen_port);
+
+    int enabled = 1;
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd == -1 || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled)) == -1 ||
+        bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) == -1 || listen(listen_fd, MAX_PEERS) == -1)
+    {
+        perror("Error opening coordinator port");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Function to start connecting to the coordinator at host:port without waiting for the handshake
+// The supervise loop adds the peer once connecting_fd is writable; returns 0 when it is not reachable yet
+int connect_to_coordinator()
+{
+    char host[256];
+    const char *port = strrchr(coordinator_address, ':');
+    if (port == NULL || port - coordinator_address >= (long)sizeof(host))
+    {
+        fprintf(stderr, "Coordinator address must be host:port\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(host, coordinator_address, port - coordinator_address);
+    host[port - coordinator_address] = '\0';
+
+    struct addrinfo hints, *addresses;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port + 1, &hints, &addresses) != 0)
+    {
+        return 0;
+    }
+
+    int connected = 0;
+    for (struct addrinfo *address = addresses; address != NULL && !connected; address = address->ai_next)
+    {
+        int fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK, address->ai_protocol);
+        if (fd == -1)
+        {
+            continue;
+        }
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            add_peer(fd);
+            connected = 1;
+        }
+        else if (errno == EINPROGRESS)
+        {
+            connecting_fd = fd;
+            connect_started = get_elapsed_time();
+            connected = 1;
+        }
+        else
+        {
+            close(fd);
+        }
+    }
+    freeaddrinfo(addresses);
+    return connected;
+}
+
+// Function to add the coordinator as a peer once its connection is established, or give it up
+// Called when connecting_fd is writable or has waited NET_TIMEOUT
+void finish_connection()
+{
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(connecting_fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0)
+    {
+        add_peer(connecting_fd);
+    }
+    else
+    {
+        close(connecting_fd);
+    }
+    connecting_fd = -1;
+}
+
+// Function to bring a tour to one canonical rotation (from its smallest city) and direction, so consecutive tours
+// of the same region differ in few positions and deltas stay small
+void normalize_tour(int *path)
+{
+    int *rotated = malloc(num_cities * sizeof(int));
+    int start = 0;
+    for (int i = 1; i < num_cities; ++i)
+    {
+        if (path[i] < path[start])
+        {
+            start = i;
+        }
+    }
+    for (int i = 0; i < num_cities; ++i)
+    {
+        rotated[i] = path[(start + i) % num_cities];
+    }
+
+    // A symmetric tour is the same in both directions; read it towards the smaller neighbour of the first city
+    if (matrix_symmetric && num_cities > 2 && rotated[1] > rotated[num_cities - 1])
+    {
+        for (int a = 1, b = num_cities - 1; a < b; ++a, --b)
+        {
+            int temp = rotated[a];
+            rotated[a] = rotated[b];
+            rotated[b] = temp;
+        }
+    }
+    memcpy(path, rotated, num_cities * sizeof(int));
+    free(rotated);
+}
+
+// Function to send the best tour of this instance to a peer that does not know one as good
+// A delta against the last tour sent is used when it is smaller than the whole tour
+void send_best_tour(Peer *peer, const int *path, int distance, double elapsed_seconds)
+{
+    if (!peer->greeted || distance >= peer->sent_distance || distance >= peer->received_distance)
+    {
+        return;
+    }
+
+    // The previous message is still being sent; the best tour is offered again at the next exchange
+    if (peer->outbox_sent < peer->outbox_size)
+    {
+        net_stats.deferred++;
+        return;
+    }
+
+    // Collect the positions that changed since the last tour sent on this connection
+    uint32_t *entries = malloc(num_cities * sizeof(uint32_t));
+    uint32_t count = 0;
+    int type = NET_FULL;
+    if (peer->sent_distance != INT_MAX)
+    {
+        type = NET_DELTA;
+        for (int i = 0; i < num_cities && type == NET_DELTA; ++i)
+        {
+            if (path[i] != peer->sent[i])
+            {
+                if (count + 2 > (uint32_t)num_cities)
+                {
+                    type = NET_FULL;
+                }
+                else
+                {
+                    entries[count++] = htonl(i);
+                    entries[count++] = htonl(path[i]);
+                }
+            }
+        }
+    }
+    if (type == NET_FULL)
+    {
+        count = num_cities;
+        for (int i = 0; i < num_cities; ++i)
+        {
+            entries[i] = htonl(path[i]);
+        }
+    }
+
+    // Spend the bandwidth budget; a postponed tour is replaced by the best one at the next exchange
+    double size = sizeof(NetHeader) + count * sizeof(uint32_t);
+    if (net_bandwidth > 0)
+    {
+        double burst = net_bandwidth > size ? net_bandwidth : size;
+        peer->tokens += net_bandwidth * elapsed_seconds;
+        peer->tokens = peer->tokens < burst ? peer->tokens : burst;
+        if (peer->tokens < size)
+        {
+            net_stats.deferred++;
+            free(entries);
+            return;
+        }
+        peer->tokens -= size;
+    }
+
+    int status = send_message(peer, type, distance, entries, count);
+    if (status == -1)
+    {
+        peer->lost = 1;
+    }
+    else if (status == 0)
+    {
+        memcpy(peer->sent, path, num_cities * sizeof(int));
+        peer->sent_distance = distance;
+        if (type == NET_FULL)
+        {
+            net_stats.full_sent++;
+        }
+        else
+        {
+            net_stats.deltas_sent++;
+        }
+    }
+    free(entries);
+}
+
+// Function to make a tour received from another instance the best of this instance if it is better
+// Workers pick it up from the elite archive when they next restart
+void adopt_remote_tour(const int *path, int distance)
+{
+    sem_wait(semaphore);
+    int adopted = distance < shared_memory->distance;
+    if (adopted)
+    {
+        memcpy(shared_memory->path, path, num_cities * sizeof(int));
+        shared_memory->distance = distance;
+        shared_memory->process_id = -1;
+        shared_memory->total_iterations = 0;
+        gettimeofday(current_time, NULL);
+        check_stop_criteria(distance);
+    }
+    sem_post(semaphore);
+
+    if (adopted)
+    {
+        net_stats.adopted++;
+        if (elite_size > 0)
+        {
+            elite_insert((int *)path, distance);
+        }
+    }
+}
+
+// Function to handle one complete message of a peer, returns -1 when the peer must be dropped
+int process_message(Peer *peer, const NetHeader *header, const uint32_t *entries)
+{
+    int type = ntohl(header->type);
+    uint32_t count = ntohl(header->count);
+    int remote_bound = (int32_t)ntohl(header->lower_bound);
+    net_stats.bytes_received += sizeof(*header) + count * sizeof(uint32_t);
+
+    // A tighter bound from another instance can only help the stopping criterion
+    if (remote_bound > lower_bound)
+    {
+        lower_bound = remote_bound;
+    }
+
+    int valid = 1;
+    if (type == NET_HELLO)
+    {
+        peer->greeted = 1;
+    }
+    else if (type == NET_FULL || (type == NET_DELTA && peer->received_distance != INT_MAX))
+    {
+        // Rebuild the tour, over the last one received when it is a delta
+        int *path = peer->received;
+        if (type == NET_FULL)
+        {
+            valid = count == (uint32_t)num_cities;
+            for (uint32_t i = 0; i < count && valid; ++i)
+            {
+                path[i] = ntohl(entries[i]);
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count && valid; i += 2)
+            {
+                uint32_t position = ntohl(entries[i]);
+                valid = position < (uint32_t)num_cities;
+                if (valid)
+                {
+                    path[position] = ntohl(entries[i + 1]);
+                }
+            }
+        }
+
+        // Check that the tour visits every city once and recompute its distance instead of trusting it
+        char *seen = calloc(matrix_stride + 1, 1);
+        for (int i = 0; i < num_cities && valid; ++i)
+        {
+            valid = path[i] >= 1 && path[i] <= num_cities && !seen[path[i]];
+            if (valid)
+            {
+                seen[path[i]] = 1;
+            }
+        }
+        free(seen);
+        if (valid)
+        {
+            peer->received_distance = calculate_distance(path);
+            net_stats.received++;
+            adopt_remote_tour(path, peer->received_distance);
+        }
+    }
+    else
+    {
+        valid = 0;
+    }
+
+    if (!valid)
+    {
+        fprintf(stderr, "Dropping a peer that sent an invalid tour\n");
+        return -1;
+    }
+    return 0;
+}
+
+// Function to read what a peer has sent without blocking, handling every message that is complete
+// A partial message stays in the inbox of the peer until the rest arrives; returns -1 when the peer must be dropped
+int receive_messages(Peer *peer)
+{
+    for (;;)
+    {
+        // The header tells how many entries follow; check it as soon as it is complete
+        size_t wanted = sizeof(NetHeader);
+        NetHeader *header = (NetHeader *)peer->inbox;
+        if (peer->inbox_used >= sizeof(NetHeader))
+        {
+            uint32_t count = ntohl(header->count);
+            int type = ntohl(header->type);
+
+            // Only instances of the same problem may exchange tours
+            if ((int)ntohl(header->num_cities) != num_cities || ntohl(header->checksum) != matrix_checksum ||
+                count > (uint32_t)num_cities || (type == NET_DELTA && count % 2 != 0))
+            {
+                fprintf(stderr, "Dropping a peer that solves a different instance\n");
+                return -1;
+            }
+            wanted += count * sizeof(uint32_t);
+        }
+        if (peer->inbox_used >= sizeof(NetHeader) && peer->inbox_used == wanted)
+        {
+            peer->inbox_used = 0;
+            if (process_message(peer, header, (const uint32_t *)(peer->inbox + sizeof(NetHeader))) == -1)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        ssize_t received = recv(peer->fd, peer->inbox + peer->inbox_used, wanted - peer->inbox_used, 0);
+        if (received == -1 && errno == EINTR)
+        {
+            continue;
+        }
+        if (received == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return 0;
+        }
+        if (received <= 0)
+        {
+            return -1;
+        }
+        peer->inbox_used += received;
+        peer->last_progress = get_elapsed_time();
+    }
+}
+
+// Function to send the best tour of this instance to every peer that does not have one as good
+void exchange_best_tour(double elapsed_seconds)
+{
+    int *path = malloc(num_cities * sizeof(int));
+    sem_wait(semaphore);
+    int distance = shared_memory->distance;
+    memcpy(path, shared_memory->path, num_cities * sizeof(int));
+    sem_post(semaphore);
+
+    // The bound may have been tightened by a peer since the tour was found
+    if (distance != INT_MAX)
+    {
+        check_stop_criteria(distance);
+        normalize_tour(path);
+        for (int i = 0; i < num_peers; ++i)
+        {
+            send_best_tour(&peers[i], path, distance, elapsed_seconds);
+        }
+    }
+    free(path);
+}
+
+// Function to change the distance from one city to another in the matrix and in its NUMA replicas
+void set_distance(int from, int to, int distance)
+{
+    long index = (long)(from - 1) * matrix_stride + (to - 1);
+    distance_matrix[index] = distance;
+    for (int i = 0; use_numa && i < num_numa_nodes; ++i)
+    {
+        matrix_replicas[i][index] = distance;
+    }
+}
+
+// Function to apply one line of the update channel to the instance, returns 0 when the line is invalid
+//   edge <a> <b> <distance>   sets the distance between two cities in both directions
+//   arc <a> <b> <distance>    sets the distance from a to b only (asymmetric instances)
+//   remove <city>             takes a city out of the instance
+//   add <d1> ... <dN>         adds a city at the lowest free number, with its distance to every city
+//                             number 1..N of the matrix in both directions
+int apply_update_line(char *line, UpdateRecord *record)
+{
+    char *end;
+    char *command = strtok_r(line, " \t\r", &end);
+    if (command == NULL || command[0] == '#')
+    {
+        return 1;
+    }
+
+    long values[3];
+    int count = 0;
+    if (strcmp(command, "add") != 0)
+    {
+        char *token;
+        while (count < 3 && (token = strtok_r(NULL, " \t\r", &end)) != NULL)
+        {
+            values[count++] = strtol(token, NULL, 10);
+        }
+    }
+
+    if ((strcmp(command, "edge") == 0 || strcmp(command, "arc") == 0) && count == 3)
+    {
+        int a = values[0], b = values[1];
+        if (a < 1 || a > matrix_stride || b < 1 || b > matrix_stride || !city_active[a] || !city_active[b] ||
+            a == b || values[2] < 0 || (command[0] == 'a' && matrix_symmetric))
+        {
+            return 0;
+        }
+        set_distance(a, b, values[2]);
+        if (command[0] == 'e')
+        {
+            set_distance(b, a, values[2]);
+        }
+        record->edges++;
+        return 1;
+    }
+
+    if (strcmp(command, "remove") == 0 && count == 1)
+    {
+        int city = values[0];
+        if (city < 1 || city > matrix_stride || !city_active[city] || num_cities <= 4)
+        {
+            return 0;
+        }
+        for (int i = 0; i < num_cities; ++i)
+        {
+            if (active_cities[i] == city)
+            {
+                active_cities[i] = active_cities[--num_cities];
+                break;
+            }
+        }
+        city_active[city] = 0;
+        record->removed++;
+        return 1;
+    }
+
+    if (strcmp(command, "add") == 0)
+    {
+        int city = 1;
+        while (city <= matrix_stride && city_active[city])
+        {
+            city++;
+        }
+        if (city > matrix_stride)
+        {
+            return 0;
+        }
+
+        // Read every distance before touching the matrix, so a short line changes nothing
+        int *distances = malloc(matrix_stride * sizeof(int));
+        char *token;
+        while (count < matrix_stride && (token = strtok_r(NULL, " \t\r", &end)) != NULL)
+        {
+            distances[count++] = strtol(token, NULL, 10);
+        }
+        if (count != matrix_stride)
+        {
+            free(distances);
+            return 0;
+        }
+        for (int other = 1; other <= matrix_stride; ++other)
+        {
+            set_distance(city, other, other == city ? 0 : distances[other - 1]);
+            set_distance(other, city, other == city ? 0 : distances[other - 1]);
+        }
+        free(distances);
+
+        // The number may belong to a city removed earlier, even in this batch, so workers must not keep it
+        // where the old city was: the version tells them it is a new city to insert
+        shared_segment->city_added[city] = instance_version + 2;
+        active_cities[num_cities++] = city;
+        city_active[city] = 1;
+        record->added++;
+        return 1;
+    }
+
+    return 0;
+}
+
+// Function to read the lines that arrived on the update channel and apply them as one batch
+// The version of the instance is odd while the batch is applied, so workers wait for it to finish,
+// and the shared best is cleared because its tour belongs to the old instance
+void poll_instance_updates()
+{
+    static char *buffer = NULL;
+    static size_t capacity = 0, length = 0;
+    static long line_number = 0;
+
+    // Append whatever the channel holds now; a FIFO without writers or a file at its end gives nothing
+    for (;;)
+    {
+        if (capacity - length < 65536)
+        {
+            capacity = capacity * 2 + 65536;
+            buffer = realloc(buffer, capacity);
+        }
+        ssize_t received = read(updates_fd, buffer + length, capacity - length);
+        if (received <= 0)
+        {
+            break;
+        }
+        length += received;
+    }
+
+    UpdateRecord record;
+    memset(&record, 0, sizeof(record));
+    int started = 0;
+    char *line = buffer;
+    char *newline;
+    while ((newline = memchr(line, '\n', buffer + length - line)) != NULL)
+    {
+        *newline = '\0';
+        line_number++;
+
+        if (!started)
+        {
+            __atomic_add_fetch(&shared_segment->instance_version, 1, __ATOMIC_ACQ_REL);
+            started = 1;
+        }
+        if (!apply_update_line(line, &record))
+        {
+            fprintf(stderr, "Ignoring invalid update on line %ld\n", line_number);
+        }
+        line = newline + 1;
+    }
+
+    // Keep an incomplete last line for the next read
+    length -= line - buffer;
+    memmove(buffer, line, length);
+    if (!started)
+    {
+        return;
+    }
+
+    // Publish the new city set and retire the tours of the old instance
+    memcpy(shared_segment->active, active_cities, num_cities * sizeof(int));
+    shared_segment->active_count = num_cities;
+    update_context();
+    sem_wait(semaphore);
+    record.time = get_elapsed_time();
+    record.instance_version = instance_version + 2;
+    record.best_before = shared_memory->distance;
+    if (shared_segment->num_updates < MAX_UPDATES)
     {
-        update_signal = 1;
+        shared_segment->updates[shared_segment->num_updates++] = record;
     }
-
-    // Only synchronize if the synchronized_this_iteration flag is set
-    if (synchronized_this_iteration)
+    else if (shared_segment->num_updates == MAX_UPDATES)
     {
-        // Synchronize child processes
-        synchronize_processes();
-
-        // Reset the flag after synchronization
-        synchronized_this_iteration = 0;
+        fprintf(stderr, "Only the first %d update batches are reported\n", MAX_UPDATES);
+        shared_segment->num_updates++;
     }
+    shared_memory->distance = INT_MAX;
+    instance_version += 2;
+    __atomic_store_n(&shared_segment->instance_version, instance_version, __ATOMIC_RELEASE);
+    sem_post(semaphore);
 }
 
-// Function to get the elapsed time in milliseconds
-long get_elapsed_time()
+// Function to print, for every batch of updates, how the best tour recovered afterwards
+void report_update_recovery()
 {
-    // Get the current time
-    struct timeval current_time;
-    gettimeofday(&current_time, NULL);
-
-    // Calculate the elapsed time in microseconds
-    long elapsed_time = (current_time.tv_sec - start_program_time.tv_sec) * 1000000 +
-                        (current_time.tv_usec - start_program_time.tv_usec);
+    printf("Instance updates from %s: %d batch%s\n", updates_path, shared_segment->num_updates,
+           shared_segment->num_updates == 1 ? "" : "es");
+    for (int u = 0; u < shared_segment->num_updates && u < MAX_UPDATES; ++u)
+    {
+        UpdateRecord *record = &shared_segment->updates[u];
+        printf("  Update %d at %ld ms (%d edges, %d removed, %d added), best before %d: ", u + 1, record->time,
+               record->edges, record->removed, record->added, record->best_before == INT_MAX ? -1 : record->best_before);
+        if (record->first_distance == 0)
+        {
+            printf("no tour published before the next update or the end\n");
+            continue;
+        }
 
-    // Convert elapsed time to milliseconds
-    return elapsed_time / 1000;
+        // Recovered once the best is within RECOVERY_GAP percent of the last best on this instance
+        long recovered = record->last_time;
+        for (int i = 0; i < shared_segment->num_best_events; ++i)
+        {
+            BestEvent *event = &shared_segment->best_events[i];
+            if (event->instance_version == record->instance_version &&
+                event->distance <= record->last_distance * (1.0 + RECOVERY_GAP / 100.0))
+            {
+                recovered = event->time;
+                break;
+            }
+        }
+        printf("repaired %d after %ld ms, within %.0f%% of the final %d after %ld ms, final after %ld ms\n",
+               record->first_distance, record->first_time - record->time, RECOVERY_GAP, record->last_distance,
+               recovered - record->time, record->last_time - record->time);
+    }
 }
 
-// Function to run the algorithm
-void run_algorithm(int process_id, int num_processes, int max_time)
+// Function to keep sending the queued messages of every peer for at most timeout milliseconds
+void flush_peers(long timeout)
 {
-    // Local variables for the current process
-    Solution current_solution;
-    int iteration = 0;
-    time_t start_time = time(NULL);
-    srand((unsigned int)time(NULL));
-
-    // Initialize the current solution with a random path
-    generate_random_path(current_solution.path, num_cities);
-    current_solution.distance = calculate_distance(current_solution.path);
-
-    current_solution.process_id = process_id; // Set process_id
-    current_solution.total_iterations = 0;    // Initialize total iterations
-
-    // Main loop for the genetic algorithm
-    while (difftime(time(NULL), start_time) < max_time)
+    long deadline = get_elapsed_time() + timeout;
+    struct pollfd fds[MAX_PEERS];
+    for (;;)
     {
-        // If an update signal is received and not synchronized in the current iteration,
-        // synchronize paths and resume activity
-        if (update_signal && !synchronized_this_iteration)
+        int count = 0;
+        for (int i = 0; i < num_peers; ++i)
         {
-            // Wait for the semaphore to access shared memory
-            sem_wait(semaphore);
-
-            // Synchronize paths with the shared memory
-            for (int i = 0; i < num_cities; ++i)
+            fds[i].fd = peers[i].fd;
+            fds[i].events = 0;
+            if (!peers[i].lost && peers[i].outbox_sent < peers[i].outbox_size)
+            {
+                fds[i].events = POLLOUT;
+                count++;
+            }
+        }
+        long left = deadline - get_elapsed_time();
+        if (count == 0 || left <= 0)
+        {
+            return;
+        }
+        if (poll(fds, num_peers, left < NET_POLL_INTERVAL ? left : NET_POLL_INTERVAL) > 0)
+        {
+            for (int i = 0; i < num_peers; ++i)
             {
-                current_solution.path[i] = shared_memory->path[i];
+                if ((fds[i].revents & (POLLOUT | POLLERR | POLLHUP)) && flush_peer(&peers[i]) == -1)
+                {
+                    peers[i].lost = 1;
+                }
             }
-            current_solution.distance = shared_memory->distance;
-            current_solution.total_iterations = shared_memory->total_iterations;
+        }
+    }
+}
 
-            // Release the semaphore
-            sem_post(semaphore);
+// Function run by the parent while the workers search: applies instance updates, accepts and reads
+// peers, exchanges the best tour every sync interval and returns once every worker has exited
+void supervise_workers(int num_processes)
+{
+    int running = num_processes;
+    long last_exchange = get_elapsed_time();
+    struct pollfd fds[MAX_PEERS + 2];
 
-            // Print synchronization information
-            printf("Process %d synchronized with updated path. New distance: %d\n", process_id, current_solution.distance);
+    if (listen_port > 0)
+    {
+        start_coordinator();
+    }
 
-            // Reset the update signal and set the flag
-            update_signal = 0;
-            synchronized_this_iteration = 1;
+    while (running > 0)
+    {
+        // Count the workers that have exited
+        while (running > 0 && waitpid(-1, NULL, WNOHANG) > 0)
+        {
+            running--;
         }
 
-        // Apply mutation (exchange mutation)
-        exchange_mutation(current_solution.path);
-
-        // Calculate the distance for the mutated path
-        int mutated_distance = calculate_distance(current_solution.path);
-
-        // Update the current solution if the mutated path is better
-        if (mutated_distance < current_solution.distance)
+        // Apply the instance updates that arrived since the last pass
+        if (updates_fd != -1)
         {
-            current_solution.distance = mutated_distance;
+            poll_instance_updates();
         }
 
-        // Update the shared memory if the current solution is better
-        update_shared_memory(&current_solution);
+        // A worker instance keeps trying to reach its coordinator, which may start later or restart
+        if (coordinator_address != NULL && num_peers == 0 && connecting_fd == -1)
+        {
+            connect_to_coordinator();
+        }
 
-        // Increment the iteration counter and update total iterations
-        iteration++;
-        current_solution.total_iterations = iteration;
+        // Wait for a connection or a message, but not past the next exchange
+        // The peers come first so that fds[i] belongs to peers[i]
+        int count = 0;
+        for (int i = 0; i < num_peers; ++i)
+        {
+            fds[count].fd = peers[i].fd;
+            fds[count++].events = POLLIN | (peers[i].outbox_sent < peers[i].outbox_size ? POLLOUT : 0);
+        }
+        int listen_index = -1;
+        if (listen_fd != -1)
+        {
+            listen_index = count;
+            fds[count].fd = listen_fd;
+            fds[count++].events = POLLIN;
+        }
+        int connecting_index = -1;
+        if (connecting_fd != -1)
+        {
+            connecting_index = count;
+            fds[count].fd = connecting_fd;
+            fds[count++].events = POLLOUT;
+        }
+        int peers_polled = num_peers;
+        if (poll(fds, count, NET_POLL_INTERVAL) > 0)
+        {
+            // Move whatever each peer allows without blocking; a peer that fails is dropped below
+            for (int i = 0; i < peers_polled; ++i)
+            {
+                if ((fds[i].revents & POLLOUT) && flush_peer(&peers[i]) == -1)
+                {
+                    peers[i].lost = 1;
+                }
+                if (!peers[i].lost && (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) &&
+                    receive_messages(&peers[i]) == -1)
+                {
+                    peers[i].lost = 1;
+                }
+            }
+            if (listen_index != -1 && (fds[listen_index].revents & POLLIN))
+            {
+                int fd = accept(listen_fd, NULL, NULL);
+                if (fd != -1)
+                {
+                    add_peer(fd);
+                }
+            }
+            if (connecting_index != -1 && fds[connecting_index].revents != 0)
+            {
+                finish_connection();
+            }
+        }
 
-        // Check if the current solution is the best
-        if (current_solution.distance < best_solution.distance)
+        // A coordinator that never answers is given up and tried again
+        long now = get_elapsed_time();
+        if (connecting_fd != -1 && now - connect_started >= NET_TIMEOUT)
         {
-            best_solution = current_solution;
+            close(connecting_fd);
+            connecting_fd = -1;
+        }
 
-            // Update the best time
-            gettimeofday(current_time, NULL);
+        if (num_peers > 0 && now - last_exchange >= sync_interval)
+        {
+            exchange_best_tour((now - last_exchange) / 1000.0);
+            last_exchange = now;
         }
+        drop_stalled_peers();
+    }
+
+    // Hand the final best tour to the peers that are still connected, waiting a bounded time for it to leave
+    flush_peers(NET_FINAL_FLUSH / 2);
+    if (num_peers > 0)
+    {
+        exchange_best_tour(sync_interval / 1000.0);
+    }
+    flush_peers(NET_FINAL_FLUSH / 2);
+    if (connecting_fd != -1)
+    {
+        close(connecting_fd);
+    }
+    while (num_peers > 0)
+    {
+        remove_peer(num_peers - 1);
+    }
+    if (listen_fd != -1)
+    {
+        close(listen_fd);
     }
 }
 
@@ -301,17 +3342,243 @@ int main(int argc, char *argv[])
     // Record the start time of the program
     gettimeofday(&start_program_time, NULL);
 
+    // Parse the optional command-line arguments
+    static struct option long_options[] = {
+        {"target", required_argument, NULL, 't'},
+        {"gap", required_argument, NULL, 'g'},
+        {"no-bound", no_argument, NULL, 'n'},
+        {"shm", required_argument, NULL, 's'},
+        {"tour", required_argument, NULL, 'r'},
+        {"mutation", required_argument, NULL, 'm'},
+        {"elite", required_argument, NULL, 'e'},
+        {"stagnation", required_argument, NULL, 'a'},
+        {"mode", required_argument, NULL, 'o'},
+        {"tenure", required_argument, NULL, 'u'},
+        {"hugepages", no_argument, NULL, 'h'},
+        {"numa", no_argument, NULL, 'N'},
+        {"clusters", required_argument, NULL, 'c'},
+        {"listen", required_argument, NULL, 'l'},
+        {"connect", required_argument, NULL, 'C'},
+        {"sync", required_argument, NULL, 'y'},
+        {"net-bandwidth", required_argument, NULL, 'b'},
+        {"stagnation-ms", required_argument, NULL, 'S'},
+        {"kick", required_argument, NULL, 'k'},
+        {"accept", required_argument, NULL, 'A'},
+        {"updates", required_argument, NULL, 'U'},
+        {"reserve", required_argument, NULL, 'R'},
+        {NULL, 0, NULL, 0}};
+    int option;
+    while ((option = getopt_long(argc, argv, "", long_options, NULL)) != -1)
+    {
+        switch (option)
+        {
+        case 't':
+            target_distance = atoi(optarg);
+            break;
+        case 'g':
+            bound_gap = atof(optarg);
+            break;
+        case 'n':
+            use_bound_stop = 0;
+            break;
+        case 's':
+            if (strcmp(optarg, "anon") == 0)
+            {
+                shm_mode = SHM_ANONYMOUS;
+            }
+            else if (strcmp(optarg, "posix") == 0)
+            {
+                shm_mode = SHM_POSIX;
+            }
+            else if (strcmp(optarg, "memfd") == 0)
+            {
+                shm_mode = SHM_MEMFD;
+            }
+            else
+            {
+                argc = 0;
+            }
+            break;
+        case 'r':
+            if (strcmp(optarg, "auto") == 0)
+            {
+                tour_mode = TOUR_AUTO;
+            }
+            else if (strcmp(optarg, "array") == 0)
+            {
+                tour_mode = TOUR_ARRAY;
+            }
+            else if (strcmp(optarg, "list") == 0)
+            {
+                tour_mode = TOUR_LIST;
+            }
+            else
+            {
+                argc = 0;
+            }
+            break;
+        case 'm':
+            fixed_operator = -2;
+            if (strcmp(optarg, "adaptive") == 0)
+            {
+                fixed_operator = -1;
+            }
+            for (int k = 0; k < NUM_OPERATORS; ++k)
+            {
+                if (strcmp(optarg, mutation_operators[k].name) == 0)
+                {
+                    fixed_operator = k;
+                }
+            }
+            if (fixed_operator == -2)
+            {
+                argc = 0;
+            }
+            break;
+        case 'e':
+            elite_size = atoi(optarg);
+            if (elite_size < 0 || elite_size > MAX_ELITE)
+            {
+                argc = 0;
+            }
+            break;
+        case 'a':
+            stagnation_limit = atoi(optarg);
+            break;
+        case 'o':
+            if (strcmp(optarg, "hill") == 0)
+            {
+                search_mode = MODE_HILL;
+            }
+            else if (strcmp(optarg, "tabu") == 0)
+            {
+                search_mode = MODE_TABU;
+            }
+            else if (strcmp(optarg, "ils") == 0)
+            {
+                search_mode = MODE_ILS;
+            }
+            else
+            {
+                argc = 0;
+            }
+            break;
+        case 'u':
+            tabu_tenure = atoi(optarg);
+            break;
+        case 'h':
+            use_hugepages = 1;
+            break;
+        case 'N':
+            use_numa = 1;
+            break;
+        case 'c':
+            num_clusters = strcmp(optarg, "auto") == 0 ? CLUSTERS_AUTO : atoi(optarg);
+            if (num_clusters < CLUSTERS_AUTO)
+            {
+                argc = 0;
+            }
+            break;
+        case 'l':
+            listen_port = atoi(optarg);
+            if (listen_port < 1 || listen_port > 65535)
+            {
+                argc = 0;
+            }
+            break;
+        case 'C':
+            coordinator_address = optarg;
+            break;
+        case 'y':
+            sync_interval = atoi(optarg);
+            if (sync_interval < 1)
+            {
+                argc = 0;
+            }
+            break;
+        case 'b':
+            net_bandwidth = atol(optarg);
+            if (net_bandwidth < 0)
+            {
+                argc = 0;
+            }
+            break;
+        case 'S':
+            stagnation_time = atoi(optarg);
+            break;
+        case 'U':
+            updates_path = optarg;
+            break;
+        case 'R':
+            reserve_cities = atoi(optarg);
+            if (reserve_cities < 0)
+            {
+                argc = 0;
+            }
+            break;
+        case 'k':
+            if (strcmp(optarg, "double-bridge") == 0)
+            {
+                kick_type = KICK_DOUBLE_BRIDGE;
+            }
+            else if (strcmp(optarg, "segment") == 0)
+            {
+                kick_type = KICK_SEGMENT;
+            }
+            else
+            {
+                argc = 0;
+            }
+            break;
+        case 'A':
+            // Either a named criterion or the percentage above the incumbent that is still accepted
+            if (strcmp(optarg, "better") == 0)
+            {
+                accept_criterion = ACCEPT_BETTER;
+            }
+            else if (strcmp(optarg, "always") == 0)
+            {
+                accept_criterion = ACCEPT_ALWAYS;
+            }
+            else
+            {
+                char *end;
+                accept_criterion = ACCEPT_THRESHOLD;
+                accept_threshold = strtod(optarg, &end);
+                if (*end != '\0' || end == optarg || accept_threshold < 0)
+                {
+                    argc = 0;
+                }
+            }
+            break;
+        default:
+            argc = 0;
+            break;
+        }
+    }
+
     // Check if the correct number of command-line arguments is provided
-    if (argc != 4)
+    if (argc - optind != 3)
     {
-        printf("Usage: %s <filename> <num_processes> <max_time>\n", argv[0]);
+        printf("Usage: %s <filename> <num_processes> <max_time> [--target <distance>] [--gap <percent>] [--no-bound] [--shm anon|posix|memfd] [--tour auto|array|list]\n"
+               "       [--mutation adaptive|exchange|insertion|inversion|scramble|or-opt]\n"
+               "       [--elite <size>] [--stagnation <moves>] [--stagnation-ms <ms>] [--mode hill|tabu|ils] [--tenure <moves>]\n"
+               "       [--kick double-bridge|segment] [--accept better|always|<percent>]\n"
+               "       [--hugepages] [--numa] [--clusters <count>|auto]\n"
+               "       [--listen <port> | --connect <host:port>] [--sync <ms>] [--net-bandwidth <bytes/s>]\n"
+               "       [--updates <file|fifo>] [--reserve <cities>]\n", argv[0]);
         exit(EXIT_FAILURE);
     }
 
     // Parse command line arguments
-    char *filename = argv[1];
-    int num_processes = atoi(argv[2]);
-    int max_time = atoi(argv[3]);
+    char *filename = argv[optind];
+    int num_processes = atoi(argv[optind + 1]);
+    int max_time = atoi(argv[optind + 2]);
+    if (num_processes < 1 || num_processes > MAX_PROCESSES)
+    {
+        fprintf(stderr, "Number of processes must be between 1 and %d\n", MAX_PROCESSES);
+        exit(EXIT_FAILURE);
+    }
 
     // Read distance matrix from file
     FILE *file = fopen(filename, "r");
@@ -323,23 +3590,109 @@ int main(int argc, char *argv[])
 
     // Parse the number of cities
     fscanf(file, "%d", &num_cities);
+    if (num_cities < 1 || num_cities + reserve_cities > MAX_CITIES)
+    {
+        fprintf(stderr, "Number of cities, including reserved ones, must be between 1 and %d\n", MAX_CITIES);
+        exit(EXIT_FAILURE);
+    }
+
+    // Leave room in every row for the cities that updates may add; the instance starts with the cities of the file
+    matrix_stride = num_cities + reserve_cities;
+    for (int i = 0; i < num_cities; ++i)
+    {
+        active_cities[i] = i + 1;
+        city_active[i + 1] = 1;
+    }
+
+    // Restart stagnating workers after a number of moves that grows with the instance
+    if (stagnation_limit <= 0)
+    {
+        stagnation_limit = num_cities * 100 > 10000 ? num_cities * 100 : 10000;
+    }
+
+    // Scale the base tabu tenure with the instance; worker tenures range from it to twice it
+    if (tabu_tenure <= 0)
+    {
+        tabu_tenure = 3 + num_cities / 50;
+    }
+
+    // Use the two-level list tour on large instances unless a representation was requested
+    use_tour_list = tour_mode == TOUR_LIST || (tour_mode == TOUR_AUTO && num_cities >= TOUR_LIST_THRESHOLD);
 
     // Allocate memory for the distance matrix
-    distance_matrix = (int *)malloc(num_cities * num_cities * sizeof(int));
+    // The matrix is shared with the workers when the parent changes it while they run
+    size_t matrix_size = (size_t)matrix_stride * matrix_stride * sizeof(int);
+    distance_matrix = map_memory(matrix_size, updates_path != NULL ? MAP_SHARED : MAP_PRIVATE, &matrix_backing);
+    if (distance_matrix == NULL)
+    {
+        perror("Error allocating distance matrix");
+        exit(EXIT_FAILURE);
+    }
 
     // Read distances from the file into the distance matrix
     for (int i = 0; i < num_cities; ++i)
     {
         for (int j = 0; j < num_cities; ++j)
         {
-            fscanf(file, "%d", &distance_matrix[i * num_cities + j]);
+            fscanf(file, "%d", &distance_matrix[i * matrix_stride + j]);
         }
     }
 
     fclose(file);
 
+    // Check whether the matrix is symmetric, which lets inversions be evaluated in constant time
+    for (int i = 0; i < num_cities; ++i)
+    {
+        for (int j = i + 1; j < num_cities; ++j)
+        {
+            if (distance_matrix[i * matrix_stride + j] != distance_matrix[j * matrix_stride + i])
+            {
+                matrix_symmetric = 0;
+            }
+        }
+    }
+    update_context();
+
+    // Compute the lower bound used to stop early on easy instances
+    lower_bound = calculate_lower_bound();
+
+    // Identify the instance to the other instances it exchanges tours with
+    if (listen_port > 0 && coordinator_address != NULL)
+    {
+        fprintf(stderr, "An instance either listens as the coordinator or connects to one\n");
+        exit(EXIT_FAILURE);
+    }
+    if (updates_path != NULL && (listen_port > 0 || coordinator_address != NULL))
+    {
+        fprintf(stderr, "Instance updates only reach this instance, so they cannot be combined with tour exchange\n");
+        exit(EXIT_FAILURE);
+    }
+    matrix_checksum = calculate_matrix_checksum();
+
+    // Split the cities into clusters that the workers solve separately before refining the whole tour
+    // Automatic counts aim at clusters small enough for Held-Karp; k-medoids does not bound their sizes,
+    // so the clusters that still come out too large are split afterwards
+    int auto_clusters = num_clusters == CLUSTERS_AUTO;
+    if (auto_clusters)
+    {
+        num_clusters = (num_cities + HELD_KARP_MAX_CITIES - 1) / HELD_KARP_MAX_CITIES;
+        num_clusters = num_clusters > num_processes ? num_clusters : num_processes;
+    }
+    if (num_clusters > num_cities)
+    {
+        num_clusters = num_cities;
+    }
+    if (num_clusters > 0)
+    {
+        build_clusters(num_clusters);
+    }
+    if (num_clusters > 0 && auto_clusters)
+    {
+        split_large_clusters();
+    }
+
     // Initialize best_solution
-    best_solution.distance = 100000;
+    best_solution.distance = INT_MAX;
     best_solution.total_iterations = 0;
     best_solution.process_id = -1; // Some invalid process ID to indicate uninitialized state
     for (int i = 0; i < MAX_CITIES; ++i)
@@ -347,14 +3700,25 @@ int main(int argc, char *argv[])
         best_solution.path[i] = i + 1;
     }
 
+    // Replicate the matrix on every NUMA node so workers never read it across the interconnect
+    if (use_numa)
+    {
+        num_numa_nodes = detect_numa_nodes();
+        replicate_distance_matrix();
+    }
+
     // Initialize shared memory and semaphore
     initialize_shared_memory();
 
-    // Attach the signal handler
-    if (signal(SIGUSR1, handle_update_signal) == SIG_ERR)
+    // Open the update channel without blocking, so a FIFO does not need a writer yet
+    if (updates_path != NULL)
     {
-        perror("Error attaching signal handler");
-        exit(EXIT_FAILURE);
+        updates_fd = open(updates_path, O_RDONLY | O_NONBLOCK);
+        if (updates_fd == -1)
+        {
+            perror("Error opening update channel");
+            exit(EXIT_FAILURE);
+        }
     }
 
     // Create processes
@@ -381,15 +3745,30 @@ int main(int argc, char *argv[])
         }
     }
 
-    // Wait for all child processes to finish
-    for (int i = 0; i < num_processes; ++i)
+    // Wait for all child processes to finish, applying instance updates and exchanging tours
+    // with the other instances meanwhile
+    if (listen_port > 0 || coordinator_address != NULL || updates_path != NULL)
+    {
+        supervise_workers(num_processes);
+    }
+    else
     {
-        wait(NULL);
+        for (int i = 0; i < num_processes; ++i)
+        {
+            wait(NULL);
+        }
     }
 
     // Print the best solution found and the time it took
     printf("\n*** Advanced Version ***\n");
-    printf("Best solution found by Process %d with %d iterations\n", shared_memory->process_id, shared_memory->total_iterations);
+    if (shared_memory->process_id == -1)
+    {
+        printf("Best solution received from another instance\n");
+    }
+    else
+    {
+        printf("Best solution found by Process %d with %d iterations\n", shared_memory->process_id, shared_memory->total_iterations);
+    }
 
     // Calculate the best time
     timersub(current_time, &start_program_time, &best_time);
@@ -404,15 +3783,155 @@ int main(int argc, char *argv[])
     }
     printf("\nDistance: %d\n", shared_memory->distance);
 
+    // Print the lower bound and why the run stopped
+    if (shared_segment->instance_version == 0)
+    {
+        printf("Lower bound: %d (gap %.2f%%)\n", lower_bound,
+               lower_bound > 0 ? 100.0 * (shared_memory->distance - lower_bound) / lower_bound : 0.0);
+    }
+    else
+    {
+        printf("Lower bound: %d before the instance was updated\n", lower_bound);
+    }
+    if (*stop_reason == STOP_NONE)
+    {
+        *stop_reason = STOP_TIME;
+    }
+    const char *stop_reasons[] = {"none", "time limit reached", "target distance reached", "within gap of lower bound"};
+    printf("Stop reason: %s\n", stop_reasons[*stop_reason]);
+
+    // Print where the matrix and the shared segment were placed
+    printf("Memory: matrix on %s, shared segment on %s, %d NUMA node%s\n", matrix_backing, segment_backing,
+           num_numa_nodes, num_numa_nodes == 1 ? "" : "s");
+    if (use_numa)
+    {
+        report_numa_placement();
+    }
+
+    // Print how the instance was decomposed and how good the stitched tour was
+    if (num_clusters > 0)
+    {
+        int smallest = num_cities, largest = 0;
+        for (int c = 0; c < num_clusters; ++c)
+        {
+            int size = cluster_start[c + 1] - cluster_start[c];
+            smallest = size < smallest ? size : smallest;
+            largest = size > largest ? size : largest;
+        }
+        printf("Decomposition: %d clusters of %d to %d cities, %d solved exactly, ", num_clusters, smallest, largest,
+               shared_segment->clusters_exact);
+        if (shared_segment->cluster_stitched)
+        {
+            printf("stitched tour %d after %ld ms\n", shared_segment->stitched_distance, shared_segment->stitch_time);
+        }
+        else
+        {
+            printf("not stitched before the run stopped\n");
+        }
+    }
+
+    // Print how quickly the best tour recovered after every batch of instance updates
+    if (updates_path != NULL)
+    {
+        report_update_recovery();
+        close(updates_fd);
+    }
+
+    // Print the traffic of the tour exchange
+    if (listen_port > 0 || coordinator_address != NULL)
+    {
+        printf("Network: %s, %d peer%s, sent %lld full and %lld delta tours (%lld bytes, %lld deferred), "
+               "received %lld tours (%lld bytes), %lld adopted, %lld dropped after stalling\n",
+               listen_port > 0 ? "coordinator" : "worker", net_stats.peers_seen, net_stats.peers_seen == 1 ? "" : "s",
+               net_stats.full_sent, net_stats.deltas_sent, net_stats.bytes_sent, net_stats.deferred, net_stats.received,
+               net_stats.bytes_received, net_stats.adopted, net_stats.stalled);
+    }
+
+    // Print the elite archive and how often the workers restarted from it
+    if (elite_size > 0)
+    {
+        int total_restarts = 0;
+        for (int i = 0; i < num_processes; ++i)
+        {
+            total_restarts += shared_segment->restarts[i];
+        }
+        printf("Elite archive (%d restarts):", total_restarts);
+        for (int i = 0; i < elite_size; ++i)
+        {
+            if (shared_segment->elite[i].distance != INT_MAX && shared_segment->elite[i].instance_version == instance_version)
+            {
+                printf(" %d", shared_segment->elite[i].distance);
+            }
+        }
+        printf("\n");
+    }
+
+    // Print how the tabu search spent its moves
+    if (search_mode == MODE_TABU)
+    {
+        TabuStats total;
+        memset(&total, 0, sizeof(total));
+        for (int i = 0; i < num_processes; ++i)
+        {
+            total.moves += shared_segment->tabu_stats[i].moves;
+            total.repeats_skipped += shared_segment->tabu_stats[i].repeats_skipped;
+            total.tabu_rejected += shared_segment->tabu_stats[i].tabu_rejected;
+            total.aspirations += shared_segment->tabu_stats[i].aspirations;
+        }
+        printf("Tabu search: %lld moves, %lld repeated tours skipped, %lld tabu candidates rejected, %lld aspirations\n",
+               total.moves, total.repeats_skipped, total.tabu_rejected, total.aspirations);
+    }
+
+    // Print how the iterated local search used its kicks
+    if (search_mode == MODE_ILS)
+    {
+        IlsStats total;
+        memset(&total, 0, sizeof(total));
+        for (int i = 0; i < num_processes; ++i)
+        {
+            total.kicks += shared_segment->ils_stats[i].kicks;
+            total.accepted += shared_segment->ils_stats[i].accepted;
+            total.improved += shared_segment->ils_stats[i].improved;
+        }
+        printf("Iterated local search (%s kicks): %lld local optima, %lld improved the incumbent, %lld accepted\n",
+               kick_type == KICK_SEGMENT ? "segment" : "double-bridge", total.kicks, total.improved, total.accepted);
+    }
+
+    // Print the statistics of every mutation operator summed over all processes
+    if (search_mode != MODE_TABU)
+    {
+        printf("Mutation operators (%s):\n", fixed_operator < 0 ? "adaptive" : "fixed");
+        printf("  %-10s %10s %14s %12s %10s %8s\n", "operator", "batches", "moves", "improvements", "gain", "ns/move");
+        for (int k = 0; k < NUM_OPERATORS; ++k)
+        {
+            OperatorStats total;
+            memset(&total, 0, sizeof(total));
+            for (int i = 0; i < num_processes; ++i)
+            {
+                OperatorStats *stats = &shared_segment->operator_stats[i][k];
+                total.batches += stats->batches;
+                total.moves += stats->moves;
+                total.improvements += stats->improvements;
+                total.gain += stats->gain;
+                total.time_ns += stats->time_ns;
+            }
+            printf("  %-10s %10lld %14lld %12lld %10lld %8.1f\n", mutation_operators[k].name, total.batches, total.moves,
+                   total.improvements, total.gain, total.moves > 0 ? (double)total.time_ns / total.moves : 0.0);
+        }
+    }
+
     // Calculate total execution time in milliseconds
     long total_execution_time = get_elapsed_time();
     printf("Total execution time: %ld ms\n", total_execution_time);
     printf("\n\n");
 
     // Clean up
-    free(distance_matrix);
-    shmdt(shared_memory);
-    shmctl(shm_id, IPC_RMID, NULL);
+    munmap(distance_matrix, mapping_size(matrix_size));
+    for (int i = 0; use_numa && i < num_numa_nodes; ++i)
+    {
+        munmap(matrix_replicas[i], mapping_size(matrix_size));
+    }
+    cleanup_shared_memory();
 
     return 0;
 }
@@ -2,8 +2,6 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/shm.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <semaphore.h>
@@ -27,7 +25,6 @@ int num_cities;                                              // Number of cities
 int *distance_matrix;                                        // Matrix to store distances between cities
 Solution *shared_memory;                                     // Shared memory to store the best solution
 sem_t *semaphore;                                            // Semaphore used for synchronization
-int shm_id;                                                  // Shared memory identifier
 struct timeval start_program_time, *current_time, best_time; // Sturct used to calculate time until best iteration
 
 // Function to initialize shared memory and semaphore
@@ -40,39 +37,25 @@ void initialize_shared_memory()
     // Map the current_time variable to shared memory
     current_time = mmap(NULL, sizeof(struct timeval), sem_protection, sem_visibility, 0, 0);
 
-    // Generate a key for the shared memory
-    key_t key = ftok(".", 'a');
-
-    // Create a shared memory segment for the Solution structure
-    shm_id = shmget(key, sizeof(Solution), IPC_CREAT | 0666);
-    if (shm_id == -1)
+    // Map an anonymous shared segment for the Solution structure, private to this run and its forked children
+    shared_memory = mmap(NULL, sizeof(Solution), sem_protection, sem_visibility, -1, 0);
+    if (shared_memory == MAP_FAILED)
     {
         perror("Error creating shared memory");
         exit(EXIT_FAILURE);
     }
 
-    // Attach the shared memory segment to the address space
-    shared_memory = (Solution *)shmat(shm_id, NULL, 0);
-    if (shared_memory == (Solution *)-1)
-    {
-        perror("Error attaching shared memory");
-        exit(EXIT_FAILURE);
-    }
-
     // Initialize distance to a large value and total_iterations to zero
     shared_memory->distance = 100000;
     shared_memory->total_iterations = 0;
 
-    // Initialize semaphore for synchronization
-    semaphore = sem_open("/my_semaphore", O_CREAT | O_EXCL, 0666, 1);
-    if (semaphore == SEM_FAILED)
+    // Map an unnamed process-shared semaphore, so concurrent runs never collide on a name
+    semaphore = mmap(NULL, sizeof(sem_t), sem_protection, sem_visibility, -1, 0);
+    if (semaphore == MAP_FAILED || sem_init(semaphore, 1, 1) == -1)
     {
         perror("Error creating semaphore");
         exit(EXIT_FAILURE);
     }
-
-    // Unlink the semaphore to remove it after the program ends
-    sem_unlink("/my_semaphore");
 }
 
 // Function to generate a random path that will be used as a starting point in the algorithm
@@ -321,8 +304,9 @@ int main(int argc, char *argv[])
 
     // Clean up - free allocated memory and remove shared memory
     free(distance_matrix);
-    shmdt(shared_memory);
-    shmctl(shm_id, IPC_RMID, NULL);
+    sem_destroy(semaphore);
+    munmap(semaphore, sizeof(sem_t));
+    munmap(shared_memory, sizeof(Solution));
 
     return 0;
 }
@@ -0,0 +1,306 @@
+// Microbenchmarks of the solver kernels and of shared memory contention
+// The kernels are the ones of tspCore.c, which the advanced version and the solver library call
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "tour.h"
+#include "tspCore.h"
+
+#define BENCH_SEED 2023
+#define BENCH_MIN_TIME_NS 200000000L // Each kernel runs for at least this long
+#define CONTENTION_OPS 20000          // Offers to the shared best tour per process
+#define CONTENTION_CITIES 1000        // Cities of the tours offered in the contention benchmark
+#define DEFAULT_MAX_PROCESSES 64
+
+// Best tour shared by the processes of the contention benchmark, guarded like the one of the advanced version
+typedef struct
+{
+    sem_t semaphore;
+    int distance;
+    int path[CONTENTION_CITIES];
+} SharedBest;
+
+int cache_miss_fd = -1;   // perf_event file descriptor, -1 when cache misses cannot be counted
+TspContext context;       // Instance the kernels run on
+int *distance_matrix;     // Matrix of the instance, cities numbered from 1
+int *cities;              // Cities of the instance, 1..num_cities in order
+SharedBest *shared_best;  // Best tour of the contention benchmark, in memory shared with its processes
+
+// Function to get a monotonic timestamp in nanoseconds
+long now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+// Function to open a hardware cache miss counter that also counts forked children
+// Leaves cache_miss_fd at -1 when the kernel or the container does not allow it
+void open_cache_miss_counter()
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    cache_miss_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Function to reset and start the cache miss counter
+void start_cache_misses()
+{
+    if (cache_miss_fd != -1)
+    {
+        ioctl(cache_miss_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(cache_miss_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+// Function to stop the cache miss counter and read it, -1 when it is not available
+long long stop_cache_misses()
+{
+    long long count = -1;
+    if (cache_miss_fd != -1)
+    {
+        ioctl(cache_miss_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(cache_miss_fd, &count, sizeof(count)) != sizeof(count))
+        {
+            count = -1;
+        }
+    }
+    return count;
+}
+
+// Function to print one result line
+void print_result(const char *name, int size, long long ops, long elapsed_ns, long long cache_misses)
+{
+    printf("%-24s %6d %12lld %10.1f", name, size, ops, (double)elapsed_ns / ops);
+    if (cache_misses >= 0)
+    {
+        printf(" %14.3f\n", (double)cache_misses / ops);
+    }
+    else
+    {
+        printf(" %14s\n", "n/a");
+    }
+}
+
+// Function to generate a random Euclidean instance with a fixed seed
+void generate_instance(int size)
+{
+    free(distance_matrix);
+    free(cities);
+    distance_matrix = malloc((size_t)size * size * sizeof(int));
+    cities = malloc(size * sizeof(int));
+    for (int i = 0; i < size; ++i)
+    {
+        cities[i] = i + 1;
+    }
+
+    srand(BENCH_SEED + size);
+    double *x = malloc(size * sizeof(double));
+    double *y = malloc(size * sizeof(double));
+    for (int i = 0; i < size; ++i)
+    {
+        x[i] = rand() % 10000;
+        y[i] = rand() % 10000;
+    }
+    for (int i = 0; i < size; ++i)
+    {
+        for (int j = 0; j < size; ++j)
+        {
+            distance_matrix[i * size + j] = (int)(hypot(x[i] - x[j], y[i] - y[j]) + 0.5);
+        }
+    }
+    free(x);
+    free(y);
+
+    context.distances = distance_matrix;
+    context.stride = size;
+    context.num_cities = size;
+    context.cities = cities;
+    context.symmetric = 1;
+}
+
+// Function to benchmark the single-process kernels on one instance size
+void benchmark_kernels(int size)
+{
+    generate_instance(size);
+    int *path = malloc(size * sizeof(int));
+    volatile long long sink = 0;
+    long long ops;
+    long start;
+    long long misses;
+
+    // core_random_path
+    context.seed = BENCH_SEED;
+    start_cache_misses();
+    start = now_ns();
+    for (ops = 0; now_ns() - start < BENCH_MIN_TIME_NS; ++ops)
+    {
+        core_random_path(&context, path);
+    }
+    misses = stop_cache_misses();
+    print_result("core_random_path", size, ops, now_ns() - start, misses);
+
+    // core_path_distance
+    start_cache_misses();
+    start = now_ns();
+    for (ops = 0; now_ns() - start < BENCH_MIN_TIME_NS; ++ops)
+    {
+        sink += core_path_distance(&context, path);
+    }
+    misses = stop_cache_misses();
+    print_result("core_path_distance", size, ops, now_ns() - start, misses);
+
+    // core_exchange_mutation and tour_reverse on both tour representations
+    for (int use_list = 0; use_list <= 1; ++use_list)
+    {
+        Tour tour;
+        tour_init(&tour, path, size, size, use_list);
+
+        context.seed = BENCH_SEED;
+        start_cache_misses();
+        start = now_ns();
+        for (ops = 0; now_ns() - start < BENCH_MIN_TIME_NS; ops += 1000)
+        {
+            for (int i = 0; i < 1000; ++i)
+            {
+                sink += core_exchange_mutation(&context, &tour);
+            }
+        }
+        misses = stop_cache_misses();
+        print_result(use_list ? "core_exchange/list" : "core_exchange/array", size, ops, now_ns() - start, misses);
+
+        // Reversals are the kernel the two-level list exists for
+        srand(BENCH_SEED);
+        start_cache_misses();
+        start = now_ns();
+        for (ops = 0; now_ns() - start < BENCH_MIN_TIME_NS; ops += 100)
+        {
+            for (int i = 0; i < 100; ++i)
+            {
+                tour_reverse(&tour, rand() % size + 1, rand() % size + 1);
+            }
+        }
+        misses = stop_cache_misses();
+        print_result(use_list ? "tour_reverse/list" : "tour_reverse/array", size, ops, now_ns() - start, misses);
+
+        tour_free(&tour);
+    }
+
+    free(path);
+}
+
+// Function to measure offers to a shared best tour with several processes making them at once
+// Every offer holds the semaphore around core_replace_best, as update_shared_memory does in the advanced version
+// When improving is set every offer is shorter than the best tour, otherwise every offer is rejected
+void benchmark_contention(int num_processes, int improving)
+{
+    core_random_path(&context, shared_best->path);
+    shared_best->distance = improving ? INT_MAX : 0;
+
+    start_cache_misses();
+    long start = now_ns();
+    for (int i = 0; i < num_processes; ++i)
+    {
+        pid_t pid = fork();
+        if (pid == -1)
+        {
+            perror("Error creating process");
+            exit(EXIT_FAILURE);
+        }
+        if (pid == 0)
+        {
+            // Every process offers decreasing distances, interleaved with the other processes
+            int path[CONTENTION_CITIES];
+            core_random_path(&context, path);
+            for (int op = 0; op < CONTENTION_OPS; ++op)
+            {
+                sem_wait(&shared_best->semaphore);
+                core_replace_best(&context, shared_best->path, &shared_best->distance, path,
+                                  INT_MAX - 1 - op * num_processes - i);
+                sem_post(&shared_best->semaphore);
+            }
+            _exit(EXIT_SUCCESS);
+        }
+    }
+    for (int i = 0; i < num_processes; ++i)
+    {
+        wait(NULL);
+    }
+    long elapsed = now_ns() - start;
+    long long misses = stop_cache_misses();
+
+    long long ops = (long long)num_processes * CONTENTION_OPS;
+    printf("%-10s %9d %12lld %10.1f %12.3f", improving ? "improving" : "rejected", num_processes, ops,
+           (double)elapsed / ops, ops * 1000.0 / elapsed);
+    if (misses >= 0)
+    {
+        printf(" %14.3f\n", (double)misses / ops);
+    }
+    else
+    {
+        printf(" %14s\n", "n/a");
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int max_processes = argc > 1 ? atoi(argv[1]) : DEFAULT_MAX_PROCESSES;
+    int sizes[] = {10, 100, 1000, 5000};
+
+    open_cache_miss_counter();
+    if (cache_miss_fd == -1)
+    {
+        printf("Cache misses not available (perf_event_open: %s)\n", strerror(errno));
+    }
+
+    printf("\n*** Kernels ***\n");
+    printf("%-24s %6s %12s %10s %14s\n", "kernel", "cities", "ops", "ns/op", "misses/op");
+    for (int i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); ++i)
+    {
+        benchmark_kernels(sizes[i]);
+    }
+
+    // Contention is measured on a mid-sized instance so each write copies a realistic path
+    printf("\n*** Shared best tour contention ***\n");
+    generate_instance(CONTENTION_CITIES);
+    shared_best = mmap(NULL, sizeof(SharedBest), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared_best == MAP_FAILED || sem_init(&shared_best->semaphore, 1, 1) == -1)
+    {
+        perror("Error creating shared memory");
+        exit(EXIT_FAILURE);
+    }
+    printf("%-10s %9s %12s %10s %12s %14s\n", "calls", "processes", "ops", "ns/op", "Mops/s", "misses/op");
+    for (int improving = 1; improving >= 0; --improving)
+    {
+        for (int processes = 1; processes <= max_processes; processes *= 2)
+        {
+            benchmark_contention(processes, improving);
+        }
+    }
+    printf("\n");
+
+    sem_destroy(&shared_best->semaphore);
+    munmap(shared_best, sizeof(SharedBest));
+    free(distance_matrix);
+    free(cities);
+    return 0;
+}
@@ -0,0 +1,473 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+
+#include "tour.h"
+
+// Function to get the first city of a segment in tour order
+static int segment_first(const TourSegment *segment)
+{
+    return segment->reversed ? segment->cities[segment->count - 1] : segment->cities[0];
+}
+
+// Function to get the last city of a segment in tour order
+static int segment_last(const TourSegment *segment)
+{
+    return segment->reversed ? segment->cities[0] : segment->cities[segment->count - 1];
+}
+
+// Function to get the position of a city inside its segment in tour order
+static int segment_offset(const Tour *tour, int city)
+{
+    const TourSegment *segment = &tour->segments[tour->parent[city]];
+    return segment->reversed ? segment->count - 1 - tour->index[city] : tour->index[city];
+}
+
+// Function to get a key that increases along the tour, starting from the first segment
+static long tour_key(const Tour *tour, int city)
+{
+    return (long)tour->segments[tour->parent[city]].rank * (tour->group_size + 1) + segment_offset(tour, city);
+}
+
+// Function to number the segments in list order after the list has changed
+static void renumber_segments(Tour *tour, int first)
+{
+    int segment = first;
+    int rank = 0;
+    tour->head = first;
+    do
+    {
+        tour->segments[segment].rank = rank++;
+        segment = tour->segments[segment].next;
+    } while (segment != first);
+}
+
+// Function to store the cities of a segment in tour order, clearing its reversed bit
+static void normalize_segment(Tour *tour, int id)
+{
+    TourSegment *segment = &tour->segments[id];
+    if (!segment->reversed)
+    {
+        return;
+    }
+
+    for (int i = 0, j = segment->count - 1; i < j; ++i, --j)
+    {
+        int temp = segment->cities[i];
+        segment->cities[i] = segment->cities[j];
+        segment->cities[j] = temp;
+    }
+    for (int i = 0; i < segment->count; ++i)
+    {
+        tour->index[segment->cities[i]] = i;
+    }
+    segment->reversed = 0;
+}
+
+// Function to split the list so that a city is the first of its segment
+static void split_before(Tour *tour, int city)
+{
+    int id = tour->parent[city];
+    normalize_segment(tour, id);
+    TourSegment *segment = &tour->segments[id];
+    int at = tour->index[city];
+    if (at == 0)
+    {
+        return;
+    }
+
+    // Move the cities from the split point onwards into a new segment after this one
+    int new_id = tour->free_segments[--tour->num_free];
+    TourSegment *tail = &tour->segments[new_id];
+    tail->count = segment->count - at;
+    tail->reversed = 0;
+    memcpy(tail->cities, segment->cities + at, tail->count * sizeof(int));
+    for (int i = 0; i < tail->count; ++i)
+    {
+        tour->parent[tail->cities[i]] = new_id;
+        tour->index[tail->cities[i]] = i;
+    }
+    segment->count = at;
+
+    // Link the new segment right after the split one
+    tail->prev = id;
+    tail->next = segment->next;
+    tour->segments[segment->next].prev = new_id;
+    segment->next = new_id;
+    tour->num_segments++;
+}
+
+// Function to merge a segment with the next one when both fit in a single segment
+static void merge_with_next(Tour *tour, int id)
+{
+    TourSegment *segment = &tour->segments[id];
+    int next_id = segment->next;
+    TourSegment *next = &tour->segments[next_id];
+    if (next_id == id || segment->count + next->count > tour->group_size)
+    {
+        return;
+    }
+
+    // Append the cities of the next segment in tour order
+    normalize_segment(tour, id);
+    normalize_segment(tour, next_id);
+    memcpy(segment->cities + segment->count, next->cities, next->count * sizeof(int));
+    for (int i = 0; i < next->count; ++i)
+    {
+        tour->parent[next->cities[i]] = id;
+        tour->index[next->cities[i]] = segment->count + i;
+    }
+    segment->count += next->count;
+
+    // Unlink the emptied segment and return it to the pool
+    segment->next = next->next;
+    tour->segments[next->next].prev = id;
+    tour->free_segments[tour->num_free++] = next_id;
+    tour->num_segments--;
+}
+
+// Function to lay out a path as evenly filled segments
+static void build_list(Tour *tour, const int *path)
+{
+    int group_size = tour->group_size;
+    int count = (tour->size + group_size - 1) / group_size;
+
+    // Every segment of the pool starts unused
+    tour->num_free = 0;
+    for (int i = tour->max_segments + 4 - 1; i >= count; --i)
+    {
+        tour->free_segments[tour->num_free++] = i;
+    }
+
+    // Fill the segments with consecutive cities of the path
+    for (int s = 0; s < count; ++s)
+    {
+        TourSegment *segment = &tour->segments[s];
+        int start = s * group_size;
+        segment->count = tour->size - start < group_size ? tour->size - start : group_size;
+        segment->reversed = 0;
+        segment->next = (s + 1) % count;
+        segment->prev = (s + count - 1) % count;
+        for (int i = 0; i < segment->count; ++i)
+        {
+            segment->cities[i] = path[start + i];
+            tour->parent[path[start + i]] = s;
+            tour->index[path[start + i]] = i;
+        }
+    }
+    tour->num_segments = count;
+    renumber_segments(tour, 0);
+}
+
+int tour_init(Tour *tour, const int *path, int size, int max_city, int use_list)
+{
+    memset(tour, 0, sizeof(Tour));
+    tour->use_list = use_list;
+    tour->max_city = max_city;
+
+    if (!use_list)
+    {
+        tour->order = malloc(max_city * sizeof(int));
+        tour->position = malloc((max_city + 1) * sizeof(int));
+        if (tour->order == NULL || tour->position == NULL)
+        {
+            tour_free(tour);
+            return -1;
+        }
+        tour_load(tour, path, size);
+        return 0;
+    }
+
+    // Segments hold about sqrt(n) cities, so there are about sqrt(n) of them
+    tour->group_size = (int)sqrt((double)max_city);
+    if (tour->group_size < 8)
+    {
+        tour->group_size = 8;
+    }
+
+    // Splits add at most two segments per reversal before the count is checked
+    tour->max_segments = 2 * ((max_city + tour->group_size - 1) / tour->group_size) + 4;
+    int pool = tour->max_segments + 4;
+
+    tour->parent = malloc((max_city + 1) * sizeof(int));
+    tour->index = malloc((max_city + 1) * sizeof(int));
+    tour->segments = malloc(pool * sizeof(TourSegment));
+    tour->segment_storage = malloc((size_t)pool * tour->group_size * sizeof(int));
+    tour->free_segments = malloc(pool * sizeof(int));
+
+    // Reversals must not allocate, so their buffer fits both a whole path and every segment of the pool
+    tour->scratch = malloc((max_city > pool ? max_city : pool) * sizeof(int));
+    if (tour->parent == NULL || tour->index == NULL || tour->segments == NULL ||
+        tour->segment_storage == NULL || tour->free_segments == NULL || tour->scratch == NULL)
+    {
+        tour_free(tour);
+        return -1;
+    }
+    for (int i = 0; i < pool; ++i)
+    {
+        tour->segments[i].cities = tour->segment_storage + (size_t)i * tour->group_size;
+    }
+
+    tour_load(tour, path, size);
+    return 0;
+}
+
+void tour_load(Tour *tour, const int *path, int size)
+{
+    tour->size = size;
+
+    if (tour->use_list)
+    {
+        build_list(tour, path);
+        return;
+    }
+
+    for (int i = 0; i < size; ++i)
+    {
+        tour->order[i] = path[i];
+        tour->position[path[i]] = i;
+    }
+}
+
+void tour_free(Tour *tour)
+{
+    free(tour->order);
+    free(tour->position);
+    free(tour->parent);
+    free(tour->index);
+    free(tour->segments);
+    free(tour->segment_storage);
+    free(tour->free_segments);
+    free(tour->scratch);
+    memset(tour, 0, sizeof(Tour));
+}
+
+int tour_next(const Tour *tour, int city)
+{
+    if (!tour->use_list)
+    {
+        int position = tour->position[city] + 1;
+        return tour->order[position == tour->size ? 0 : position];
+    }
+
+    const TourSegment *segment = &tour->segments[tour->parent[city]];
+    int i = tour->index[city] + (segment->reversed ? -1 : 1);
+    if (i < 0 || i >= segment->count)
+    {
+        return segment_first(&tour->segments[segment->next]);
+    }
+    return segment->cities[i];
+}
+
+int tour_prev(const Tour *tour, int city)
+{
+    if (!tour->use_list)
+    {
+        int position = tour->position[city];
+        return tour->order[position == 0 ? tour->size - 1 : position - 1];
+    }
+
+    const TourSegment *segment = &tour->segments[tour->parent[city]];
+    int i = tour->index[city] + (segment->reversed ? 1 : -1);
+    if (i < 0 || i >= segment->count)
+    {
+        return segment_last(&tour->segments[segment->prev]);
+    }
+    return segment->cities[i];
+}
+
+int tour_between(const Tour *tour, int a, int b, int c)
+{
+    long key_a, key_b, key_c;
+    if (!tour->use_list)
+    {
+        key_a = tour->position[a];
+        key_b = tour->position[b];
+        key_c = tour->position[c];
+    }
+    else
+    {
+        key_a = tour_key(tour, a);
+        key_b = tour_key(tour, b);
+        key_c = tour_key(tour, c);
+    }
+
+    // Measure b and c as forward distances from a around the cycle
+    if (key_b < key_a)
+    {
+        key_b += LONG_MAX / 2;
+    }
+    if (key_c < key_a)
+    {
+        key_c += LONG_MAX / 2;
+    }
+    return key_b <= key_c;
+}
+
+void tour_reverse(Tour *tour, int a, int b)
+{
+    if (a == b)
+    {
+        return;
+    }
+
+    if (!tour->use_list)
+    {
+        // Swap cities inwards from both ends, wrapping around the array
+        int i = tour->position[a];
+        int j = tour->position[b];
+        int length = (j - i + tour->size) % tour->size + 1;
+        for (int k = 0; k < length / 2; ++k)
+        {
+            int city_i = tour->order[i];
+            int city_j = tour->order[j];
+            tour->order[i] = city_j;
+            tour->position[city_j] = i;
+            tour->order[j] = city_i;
+            tour->position[city_i] = j;
+            i = i + 1 == tour->size ? 0 : i + 1;
+            j = j == 0 ? tour->size - 1 : j - 1;
+        }
+        return;
+    }
+
+    // Reverse in place when the path lies inside a single segment
+    int id = tour->parent[a];
+    if (id == tour->parent[b] && segment_offset(tour, a) <= segment_offset(tour, b))
+    {
+        TourSegment *segment = &tour->segments[id];
+        int i = tour->index[a];
+        int j = tour->index[b];
+        if (i > j)
+        {
+            int temp = i;
+            i = j;
+            j = temp;
+        }
+        for (; i < j; ++i, --j)
+        {
+            int city_i = segment->cities[i];
+            int city_j = segment->cities[j];
+            segment->cities[i] = city_j;
+            tour->index[city_j] = i;
+            segment->cities[j] = city_i;
+            tour->index[city_i] = j;
+        }
+        return;
+    }
+
+    // Rebuild evenly filled segments when splits have left too many small ones
+    if (tour->num_segments > tour->max_segments)
+    {
+        tour_to_path(tour, tour->scratch);
+        build_list(tour, tour->scratch);
+    }
+
+    // Split so that the path is made of whole segments
+    int after_b = tour_next(tour, b);
+    split_before(tour, a);
+    if (after_b != a)
+    {
+        split_before(tour, after_b);
+    }
+    int first = tour->parent[a];
+    int last = tour->parent[b];
+
+    // Collect the segments of the path in tour order
+    int *range = tour->scratch;
+    int length = 0;
+    for (int s = first;; s = tour->segments[s].next)
+    {
+        range[length++] = s;
+        if (s == last)
+        {
+            break;
+        }
+    }
+
+    // Flip every segment of the path
+    for (int k = 0; k < length; ++k)
+    {
+        tour->segments[range[k]].reversed ^= 1;
+    }
+
+    if (length < tour->num_segments)
+    {
+        // Relink the segments of the path in reverse order between its neighbours
+        int before = tour->segments[first].prev;
+        int after = tour->segments[last].next;
+        int previous = before;
+        for (int k = length - 1; k >= 0; --k)
+        {
+            tour->segments[previous].next = range[k];
+            tour->segments[range[k]].prev = previous;
+            previous = range[k];
+        }
+        tour->segments[previous].next = after;
+        tour->segments[after].prev = previous;
+
+        // Merge small segments at both ends of the reversed path
+        merge_with_next(tour, tour->parent[a]);
+        merge_with_next(tour, tour->segments[tour->parent[b]].prev);
+    }
+    else
+    {
+        // The whole tour is reversed, so the list direction flips
+        for (int k = 0; k < length; ++k)
+        {
+            TourSegment *segment = &tour->segments[range[k]];
+            int temp = segment->next;
+            segment->next = segment->prev;
+            segment->prev = temp;
+        }
+    }
+
+    renumber_segments(tour, tour->parent[b]);
+}
+
+void tour_swap(Tour *tour, int a, int b)
+{
+    if (!tour->use_list)
+    {
+        int position_a = tour->position[a];
+        int position_b = tour->position[b];
+        tour->order[position_a] = b;
+        tour->position[b] = position_a;
+        tour->order[position_b] = a;
+        tour->position[a] = position_b;
+        return;
+    }
+
+    // Exchange the slots of both cities in their segment arrays
+    int parent_a = tour->parent[a];
+    int index_a = tour->index[a];
+    tour->segments[parent_a].cities[index_a] = b;
+    tour->segments[tour->parent[b]].cities[tour->index[b]] = a;
+    tour->parent[a] = tour->parent[b];
+    tour->index[a] = tour->index[b];
+    tour->parent[b] = parent_a;
+    tour->index[b] = index_a;
+}
+
+void tour_to_path(const Tour *tour, int *path)
+{
+    if (!tour->use_list)
+    {
+        memcpy(path, tour->order, tour->size * sizeof(int));
+        return;
+    }
+
+    // Walk the segments in list order and read each one in its own direction
+    int n = 0;
+    int s = tour->head;
+    do
+    {
+        const TourSegment *segment = &tour->segments[s];
+        for (int i = 0; i < segment->count; ++i)
+        {
+            path[n++] = segment->reversed ? segment->cities[segment->count - 1 - i] : segment->cities[i];
+        }
+        s = segment->next;
+    } while (s != tour->head);
+}
@@ -0,0 +1,70 @@
+#ifndef TOUR_H
+#define TOUR_H
+
+// Instances with at least this many cities use the two-level list by default
+#define TOUR_LIST_THRESHOLD 1000
+
+// Segment of the two-level list: a short array of cities read forwards or backwards
+typedef struct
+{
+    int *cities;  // Cities of the segment in internal order
+    int count;    // Number of cities stored in the segment
+    int reversed; // Whether the segment is traversed from the end of the array
+    int rank;     // Position of the segment in the segment list
+    int next;     // Next segment in tour order
+    int prev;     // Previous segment in tour order
+} TourSegment;
+
+// Tour over cities numbered 1..max_city, stored as a flat array or as a two-level list
+typedef struct
+{
+    int use_list; // Whether the two-level list representation is used
+    int size;     // Number of cities in the tour
+    int max_city; // Largest city number the tour can hold
+
+    // Array representation
+    int *order;    // City at each position
+    int *position; // Position of each city
+
+    // Two-level list representation
+    int *parent;           // Segment holding each city
+    int *index;            // Index of each city in its segment array
+    TourSegment *segments; // Pool of segments
+    int *segment_storage;  // City storage shared by the segment pool
+    int *free_segments;    // Stack of unused segments
+    int num_free;          // Number of unused segments
+    int num_segments;      // Number of segments in use
+    int head;              // Segment with rank 0, where the tour starts
+    int max_segments;      // Segments in use that trigger a rebuild
+    int group_size;        // Maximum number of cities per segment
+    int *scratch;          // Buffer of tour_reverse for a rebuilt path or a range of segments
+} Tour;
+
+// Function to create a tour from a path, using the two-level list when use_list is set
+int tour_init(Tour *tour, const int *path, int size, int max_city, int use_list);
+
+// Function to replace the cities of a tour with a new path of the same capacity
+void tour_load(Tour *tour, const int *path, int size);
+
+// Function to release the memory of a tour
+void tour_free(Tour *tour);
+
+// Function to get the city after a city in tour order
+int tour_next(const Tour *tour, int city);
+
+// Function to get the city before a city in tour order
+int tour_prev(const Tour *tour, int city);
+
+// Function to check whether b lies on the path going forward from a to c
+int tour_between(const Tour *tour, int a, int b, int c);
+
+// Function to reverse the path going forward from a to b
+void tour_reverse(Tour *tour, int a, int b);
+
+// Function to exchange the positions of two cities
+void tour_swap(Tour *tour, int a, int b);
+
+// Function to write the tour as a path starting at its first city
+void tour_to_path(const Tour *tour, int *path);
+
+#endif
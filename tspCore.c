@@ -0,0 +1,337 @@
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tspCore.h"
+
+void core_random_path(TspContext *context, int *path)
+{
+    int size = context->num_cities;
+
+    // Initialize the path with the cities of the instance
+    for (int i = 0; i < size; ++i)
+    {
+        path[i] = context->cities[i];
+    }
+
+    // Shuffle the path using the Fisher-Yates algorithm
+    for (int i = size - 1; i > 0; --i)
+    {
+        // Generate a random index between 0 and i (inclusive)
+        int j = rand_r(&context->seed) % (i + 1);
+
+        // Swap path[i] and path[j]
+        int temp = path[i];
+        path[i] = path[j];
+        path[j] = temp;
+    }
+}
+
+int core_path_distance(const TspContext *context, const int *path)
+{
+    int size = context->num_cities;
+    int total_distance = 0;
+
+    // Add the distance from every city to the next one
+    for (int i = 0; i < size - 1; ++i)
+    {
+        total_distance += core_distance(context, path[i], path[i + 1]);
+    }
+
+    // Add the distance from the last city back to the starting city
+    total_distance += core_distance(context, path[size - 1], path[0]);
+    return total_distance;
+}
+
+int core_exchange_delta(const TspContext *context, const Tour *tour, int a, int b)
+{
+    int prev_a = tour_prev(tour, a);
+    int next_a = tour_next(tour, a);
+    int prev_b = tour_prev(tour, b);
+    int next_b = tour_next(tour, b);
+
+    // Adjacent cities share an edge, which keeps its cities but changes direction
+    if (next_a == b)
+    {
+        return core_distance(context, prev_a, b) + core_distance(context, b, a) + core_distance(context, a, next_b) -
+               core_distance(context, prev_a, a) - core_distance(context, a, b) - core_distance(context, b, next_b);
+    }
+    if (next_b == a)
+    {
+        return core_distance(context, prev_b, a) + core_distance(context, a, b) + core_distance(context, b, next_a) -
+               core_distance(context, prev_b, b) - core_distance(context, b, a) - core_distance(context, a, next_a);
+    }
+
+    return core_distance(context, prev_a, b) + core_distance(context, b, next_a) + core_distance(context, prev_b, a) +
+           core_distance(context, a, next_b) - core_distance(context, prev_a, a) - core_distance(context, a, next_a) -
+           core_distance(context, prev_b, b) - core_distance(context, b, next_b);
+}
+
+int core_exchange_mutation(TspContext *context, Tour *tour)
+{
+    // Every tour of fewer than three cities has the same length
+    if (context->num_cities < 3)
+    {
+        return 0;
+    }
+
+    // Choose two different random cities to exchange
+    int city1 = core_random_city(context);
+    int city2;
+    do
+    {
+        city2 = core_random_city(context);
+    } while (city1 == city2);
+
+    // Evaluate the exchange in constant time from the neighbours of both cities
+    int delta = core_exchange_delta(context, tour, city1, city2);
+    if (delta >= 0)
+    {
+        return 0;
+    }
+
+    // Swap the cities at their positions
+    tour_swap(tour, city1, city2);
+    return delta;
+}
+
+int core_inversion_mutation(TspContext *context, Tour *tour)
+{
+    if (context->num_cities < 4)
+    {
+        return 0;
+    }
+
+    // Choose the edges (a, b) and (c, d) so that the reversed path b..c has at least two cities
+    int a = core_random_city(context);
+    int b = tour_next(tour, a);
+    int c;
+    do
+    {
+        c = core_random_city(context);
+    } while (c == a || c == b || tour_next(tour, c) == a);
+    int d = tour_next(tour, c);
+
+    // Only the two replaced edges change on symmetric matrices
+    int delta = core_distance(context, a, c) + core_distance(context, b, d) - core_distance(context, a, b) -
+                core_distance(context, c, d);
+
+    // On asymmetric matrices every edge of the reversed path changes direction
+    if (!context->symmetric)
+    {
+        for (int city = b; city != c; city = tour_next(tour, city))
+        {
+            int next = tour_next(tour, city);
+            delta += core_distance(context, next, city) - core_distance(context, city, next);
+        }
+    }
+
+    if (delta >= 0)
+    {
+        return 0;
+    }
+
+    tour_reverse(tour, b, c);
+    return delta;
+}
+
+int core_move_segment_mutation(TspContext *context, Tour *tour, int length)
+{
+    // The segment, its old neighbours and its new neighbours must all be distinct
+    if (context->num_cities < length + 3)
+    {
+        return 0;
+    }
+
+    // Choose the segment s1..s2 from a random city
+    int s1 = core_random_city(context);
+    int s2 = s1;
+    for (int i = 1; i < length; ++i)
+    {
+        s2 = tour_next(tour, s2);
+    }
+    int prev_s = tour_prev(tour, s1);
+    int next_s = tour_next(tour, s2);
+
+    // Choose the city p after which the segment is inserted, outside the segment and not its current place
+    int p;
+    do
+    {
+        p = core_random_city(context);
+    } while (p == prev_s || tour_between(tour, s1, p, s2));
+    int q = tour_next(tour, p);
+
+    // Cost of the edges inside the segment in both directions (a few cities at most)
+    int inner_forward = 0;
+    int inner_reversed = 0;
+    for (int city = s1; city != s2; city = tour_next(tour, city))
+    {
+        int next = tour_next(tour, city);
+        inner_forward += core_distance(context, city, next);
+        inner_reversed += core_distance(context, next, city);
+    }
+
+    // Evaluate removing the segment and inserting it between p and q in both directions
+    int removal = core_distance(context, prev_s, next_s) - core_distance(context, prev_s, s1) -
+                  core_distance(context, s2, next_s) - core_distance(context, p, q);
+    int delta_forward = removal + core_distance(context, p, s1) + core_distance(context, s2, q);
+    int delta_reversed = removal + core_distance(context, p, s2) + core_distance(context, s1, q) + inner_reversed -
+                         inner_forward;
+    int reversed = length > 1 && delta_reversed < delta_forward;
+    int delta = reversed ? delta_reversed : delta_forward;
+    if (delta >= 0)
+    {
+        return 0;
+    }
+
+    // Exchange the segment with the cities next_s..p using three reversals
+    tour_reverse(tour, s1, p);
+    tour_reverse(tour, p, next_s);
+    if (!reversed)
+    {
+        tour_reverse(tour, s2, s1);
+    }
+    return delta;
+}
+
+void core_double_bridge_kick(TspContext *context, int *path)
+{
+    int size = context->num_cities;
+    if (size < 4)
+    {
+        return;
+    }
+
+    // Draw three distinct cut positions in 1..size-1 and sort them
+    int cut[3];
+    cut[0] = 1 + rand_r(&context->seed) % (size - 1);
+    do
+    {
+        cut[1] = 1 + rand_r(&context->seed) % (size - 1);
+    } while (cut[1] == cut[0]);
+    do
+    {
+        cut[2] = 1 + rand_r(&context->seed) % (size - 1);
+    } while (cut[2] == cut[0] || cut[2] == cut[1]);
+    for (int i = 0; i < 2; ++i)
+    {
+        for (int j = 0; j < 2 - i; ++j)
+        {
+            if (cut[j] > cut[j + 1])
+            {
+                int temp = cut[j];
+                cut[j] = cut[j + 1];
+                cut[j + 1] = temp;
+            }
+        }
+    }
+
+    // Swap B and C in place: reversing B, C and then both swaps their order and keeps their direction
+    int *segments[3] = {&path[cut[0]], &path[cut[1]], &path[cut[0]]};
+    int lengths[3] = {cut[1] - cut[0], cut[2] - cut[1], cut[2] - cut[0]};
+    for (int k = 0; k < 3; ++k)
+    {
+        for (int i = 0, j = lengths[k] - 1; i < j; ++i, --j)
+        {
+            int temp = segments[k][i];
+            segments[k][i] = segments[k][j];
+            segments[k][j] = temp;
+        }
+    }
+}
+
+int core_replace_best(const TspContext *context, int *best_path, int *best_distance, const int *path, int distance)
+{
+    if (distance >= *best_distance)
+    {
+        return 0;
+    }
+
+    // Copy only the cities of the instance, not the whole capacity of the best path
+    memcpy(best_path, path, context->num_cities * sizeof(int));
+    *best_distance = distance;
+    return 1;
+}
+
+int core_held_karp_tour(const TspContext *context, const int *cities, int m, int *tour)
+{
+    tour[0] = cities[0];
+    if (m <= 2)
+    {
+        tour[m - 1] = cities[m - 1];
+        return 0;
+    }
+
+    // cost[mask * others + j]: shortest path from cities[0] through the cities in mask ending at cities[j + 1]
+    int others = m - 1;
+    int full = 1 << others;
+    int *cost = malloc((size_t)full * others * sizeof(int));
+    unsigned char *from = malloc((size_t)full * others);
+    if (cost == NULL || from == NULL)
+    {
+        free(cost);
+        free(from);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < (size_t)full * others; ++i)
+    {
+        cost[i] = INT_MAX;
+    }
+    for (int j = 0; j < others; ++j)
+    {
+        cost[(size_t)(1 << j) * others + j] = core_distance(context, cities[0], cities[j + 1]);
+    }
+
+    // Extend every path by one unvisited city, in order of increasing sets
+    for (int mask = 1; mask < full; ++mask)
+    {
+        for (int j = 0; j < others; ++j)
+        {
+            int current = cost[(size_t)mask * others + j];
+            if (!(mask & (1 << j)) || current == INT_MAX)
+            {
+                continue;
+            }
+            for (int next = 0; next < others; ++next)
+            {
+                if (mask & (1 << next))
+                {
+                    continue;
+                }
+                int extended = current + core_distance(context, cities[j + 1], cities[next + 1]);
+                size_t index = (size_t)(mask | (1 << next)) * others + next;
+                if (extended < cost[index])
+                {
+                    cost[index] = extended;
+                    from[index] = j;
+                }
+            }
+        }
+    }
+
+    // Close the tour at the best last city and walk the table back to the start
+    int last = 0;
+    int best = INT_MAX;
+    for (int j = 0; j < others; ++j)
+    {
+        int closed = cost[(size_t)(full - 1) * others + j] + core_distance(context, cities[j + 1], cities[0]);
+        if (closed < best)
+        {
+            best = closed;
+            last = j;
+        }
+    }
+    int mask = full - 1;
+    for (int position = m - 1; position > 0; --position)
+    {
+        tour[position] = cities[last + 1];
+        int previous = from[(size_t)mask * others + last];
+        mask &= ~(1 << last);
+        last = previous;
+    }
+
+    free(cost);
+    free(from);
+    return 0;
+}
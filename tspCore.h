@@ -0,0 +1,65 @@
+#ifndef TSP_CORE_H
+#define TSP_CORE_H
+
+// Search kernels shared by the advanced version, the solver library and the microbenchmarks
+// Every kernel reads the instance and the random state from a TspContext instead of globals
+
+#include <stdlib.h>
+#include "tour.h"
+
+#define OR_OPT_MAX 3 // Longest segment moved by or-opt
+
+// Instance a kernel works on and the random state of its caller
+typedef struct
+{
+    const int *distances; // Row-major distance matrix, cities numbered from 1
+    int stride;           // Length of a row of the matrix, at least the largest city number
+    int num_cities;       // Number of cities in the instance
+    const int *cities;    // Cities of the instance, the first num_cities entries are valid
+    int symmetric;        // Whether d[i][j] == d[j][i] for every pair of cities
+    unsigned int seed;    // Random state of the caller, used with rand_r
+} TspContext;
+
+// Function to get the distance between two cities numbered from 1
+static inline int core_distance(const TspContext *context, int from, int to)
+{
+    return context->distances[(size_t)(from - 1) * context->stride + (to - 1)];
+}
+
+// Function to draw a random city of the instance
+static inline int core_random_city(TspContext *context)
+{
+    return context->cities[rand_r(&context->seed) % context->num_cities];
+}
+
+// Function to fill path with the cities of the instance in random order (Fisher-Yates shuffle)
+void core_random_path(TspContext *context, int *path);
+
+// Function to calculate the total distance of a closed path through every city of the instance
+int core_path_distance(const TspContext *context, const int *path);
+
+// Function to compute the change in distance caused by exchanging two cities of a tour
+int core_exchange_delta(const TspContext *context, const Tour *tour, int a, int b);
+
+// Function to exchange two random cities of a tour, keeping the move only when it shortens the tour
+// Returns the change in distance, or 0 when the move was rejected (as every mutation below)
+int core_exchange_mutation(TspContext *context, Tour *tour);
+
+// Function to reverse the path between two random edges of a tour (2-opt)
+int core_inversion_mutation(TspContext *context, Tour *tour);
+
+// Function to move a random run of length cities next to another city, forwards or reversed (or-opt)
+int core_move_segment_mutation(TspContext *context, Tour *tour, int length);
+
+// Function to apply a double-bridge kick to a path of every city: A B C D becomes A C B D
+void core_double_bridge_kick(TspContext *context, int *path);
+
+// Function to copy a tour over a best tour when it is shorter, called with the lock guarding the best tour held
+// Returns whether the tour was copied; only the cities of the instance are written
+int core_replace_best(const TspContext *context, int *best_path, int *best_distance, const int *path, int distance);
+
+// Function to find the shortest closed tour through m cities with the Held-Karp dynamic program
+// The tour starts at cities[0]; returns 0, or -1 with errno set when the table cannot be allocated
+int core_held_karp_tour(const TspContext *context, const int *cities, int m, int *tour);
+
+#endif
@@ -0,0 +1,446 @@
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tour.h"
+#include "tspCore.h"
+#include "tspSolver.h"
+
+#define CHECK_INTERVAL 256      // Moves between two checks of the stop criteria
+#define MIN_STAGNATION 10000    // Fewest moves without improvement before a kick
+#define STAGNATION_PER_CITY 100 // Moves without improvement before a kick, per city
+#define RUNNING -1              // stop_reason of a search that has not stopped
+
+// State of one solve, shared by its threads; it replaces the globals of the executables
+typedef struct
+{
+    TspContext instance;   // Matrix of the caller and the cities 1..num_cities, copied by every worker
+    int *cities;           // Cities of the instance in order, referenced by instance
+    TspOptions options;    // Copy of the options of the call
+    long stagnation;       // Moves without improvement before a thread kicks its tour
+    TspCancel *cancel;     // Token of the caller, may be NULL
+    TspCallback callback;  // Improvement callback of the caller, may be NULL
+    void *user_data;       // Passed back to the callback
+    struct timespec start; // When the solve started
+
+    pthread_mutex_t lock;    // Guards the best tour and serializes the callback
+    int *best_path;          // Best tour found by any thread
+    int best_distance;       // Distance of best_path, also read without the lock to reject worse tours
+    int best_thread;         // Thread that found best_path
+    volatile int stop_reason; // RUNNING, or the first TSP_STOP_* reason met
+} Search;
+
+// State of one worker thread
+typedef struct
+{
+    Search *search;       // Solve the thread belongs to
+    int id;               // Index of the thread
+    TspContext context;   // Instance of the solve with the random state of the thread
+    long long iterations; // Moves tried by the thread
+    int *path;            // Scratch path for kicks
+    int *local_best;      // Best tour found by the thread
+    Tour tour;            // Current tour of the thread
+    pthread_t thread;
+} Worker;
+
+// Function to get the elapsed time of a solve in milliseconds
+static long get_elapsed_ms(const Search *search)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - search->start.tv_sec) * 1000 + (now.tv_nsec - search->start.tv_nsec) / 1000000;
+}
+
+// Function to record why a solve stopped; the first reason wins
+static void set_stop_reason(Search *search, int reason)
+{
+    int expected = RUNNING;
+    __atomic_compare_exchange_n(&search->stop_reason, &expected, reason, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+void tsp_default_options(TspOptions *options)
+{
+    options->num_threads = 1;
+    options->max_time_ms = 1000;
+    options->max_iterations = 0;
+    options->target_distance = -1;
+    options->seed = 1;
+    options->stagnation = 0;
+    options->exact_max_cities = TSP_EXACT_MAX_CITIES;
+}
+
+void tsp_cancel_init(TspCancel *cancel)
+{
+    __atomic_store_n(&cancel->cancelled, 0, __ATOMIC_SEQ_CST);
+}
+
+void tsp_cancel(TspCancel *cancel)
+{
+    __atomic_store_n(&cancel->cancelled, 1, __ATOMIC_SEQ_CST);
+}
+
+int tsp_cancelled(const TspCancel *cancel)
+{
+    return __atomic_load_n(&cancel->cancelled, __ATOMIC_SEQ_CST);
+}
+
+int tsp_load_matrix(const char *filename, int **distances, int *num_cities)
+{
+    FILE *file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        return -1;
+    }
+
+    // Parse the number of cities, then every distance of the matrix
+    int size;
+    if (fscanf(file, "%d", &size) != 1 || size < 1 || (size_t)size > 65536)
+    {
+        fclose(file);
+        errno = EINVAL;
+        return -1;
+    }
+    int *matrix = malloc((size_t)size * size * sizeof(int));
+    if (matrix == NULL)
+    {
+        fclose(file);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (size_t i = 0; i < (size_t)size * size; ++i)
+    {
+        if (fscanf(file, "%d", &matrix[i]) != 1)
+        {
+            free(matrix);
+            fclose(file);
+            errno = EINVAL;
+            return -1;
+        }
+    }
+    fclose(file);
+
+    *distances = matrix;
+    *num_cities = size;
+    return 0;
+}
+
+int tsp_path_distance(const int *distances, int num_cities, const int *path)
+{
+    TspContext context = {.distances = distances, .stride = num_cities, .num_cities = num_cities};
+    return core_path_distance(&context, path);
+}
+
+// Function to offer a tour as the best tour of the solve and report it to the callback when it is
+static void publish_tour(Search *search, int thread_id, long long iterations, const int *path, int distance)
+{
+    // Most offers are worse than the best tour and are rejected without taking the lock
+    if (distance >= __atomic_load_n(&search->best_distance, __ATOMIC_RELAXED))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&search->lock);
+    if (distance < search->best_distance)
+    {
+        memcpy(search->best_path, path, search->instance.num_cities * sizeof(int));
+        __atomic_store_n(&search->best_distance, distance, __ATOMIC_RELAXED);
+        search->best_thread = thread_id;
+
+        if (search->callback != NULL)
+        {
+            TspProgress progress;
+            progress.distance = distance;
+            progress.elapsed_ms = get_elapsed_ms(search);
+            progress.iterations = iterations;
+            progress.thread_id = thread_id;
+            if (search->callback(search->best_path, search->instance.num_cities, &progress, search->user_data) != 0)
+            {
+                set_stop_reason(search, TSP_STOP_CANCELLED);
+            }
+        }
+
+        if (search->options.target_distance >= 0 && distance <= search->options.target_distance)
+        {
+            set_stop_reason(search, TSP_STOP_TARGET);
+        }
+    }
+    pthread_mutex_unlock(&search->lock);
+}
+
+// Function to check whether a worker must stop; the iteration limit only stops the worker itself
+static int check_stop_criteria(Worker *worker)
+{
+    Search *search = worker->search;
+    if (search->cancel != NULL && tsp_cancelled(search->cancel))
+    {
+        set_stop_reason(search, TSP_STOP_CANCELLED);
+    }
+    if (search->options.max_time_ms > 0 && get_elapsed_ms(search) >= search->options.max_time_ms)
+    {
+        set_stop_reason(search, TSP_STOP_TIME);
+    }
+    if (__atomic_load_n(&search->stop_reason, __ATOMIC_SEQ_CST) != RUNNING)
+    {
+        return 1;
+    }
+    return search->options.max_iterations > 0 && worker->iterations >= search->options.max_iterations;
+}
+
+// Function run by every worker thread: local search with random improving moves, kicking the best tour
+// of the thread with a double bridge whenever it stops improving (iterated local search)
+static void *run_algorithm(void *argument)
+{
+    Worker *worker = argument;
+    Search *search = worker->search;
+    TspContext *context = &worker->context;
+    int size = context->num_cities;
+
+    int current = core_path_distance(context, worker->local_best);
+    int local_best = current;
+    long long last_improvement = 0;
+    publish_tour(search, worker->id, 0, worker->local_best, local_best);
+
+    while (!check_stop_criteria(worker))
+    {
+        for (int i = 0; i < CHECK_INTERVAL; ++i)
+        {
+            int move = rand_r(&context->seed) % 3;
+            if (move == 0)
+            {
+                current += core_exchange_mutation(context, &worker->tour);
+            }
+            else if (move == 1)
+            {
+                current += core_inversion_mutation(context, &worker->tour);
+            }
+            else
+            {
+                current += core_move_segment_mutation(context, &worker->tour, 1 + rand_r(&context->seed) % OR_OPT_MAX);
+            }
+        }
+        worker->iterations += CHECK_INTERVAL;
+
+        if (current < local_best)
+        {
+            local_best = current;
+            last_improvement = worker->iterations;
+            tour_to_path(&worker->tour, worker->local_best);
+            publish_tour(search, worker->id, worker->iterations, worker->local_best, local_best);
+        }
+        else if (worker->iterations - last_improvement >= search->stagnation)
+        {
+            // Restart from a kicked copy of the best tour of the thread
+            memcpy(worker->path, worker->local_best, size * sizeof(int));
+            core_double_bridge_kick(context, worker->path);
+            tour_load(&worker->tour, worker->path, size);
+            current = core_path_distance(context, worker->path);
+            last_improvement = worker->iterations;
+        }
+    }
+    return NULL;
+}
+
+// Function to release the buffers of the workers that were set up
+static void free_workers(Worker *workers, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        tour_free(&workers[i].tour);
+        free(workers[i].path);
+        free(workers[i].local_best);
+    }
+    free(workers);
+}
+
+int tsp_solve(const int *distances, int num_cities, const TspOptions *options, TspCancel *cancel,
+              TspCallback callback, void *user_data, TspResult *result)
+{
+    TspOptions defaults;
+    if (options == NULL)
+    {
+        tsp_default_options(&defaults);
+        options = &defaults;
+    }
+
+    // Reject bad arguments, including searches that nothing would ever stop
+    if (distances == NULL || result == NULL || num_cities < 1 || num_cities > 65536 ||
+        options->num_threads < 1 || options->num_threads > TSP_MAX_THREADS || options->max_time_ms < 0 ||
+        options->max_iterations < 0 || options->stagnation < 0 ||
+        (options->max_time_ms == 0 && options->max_iterations == 0 && options->target_distance < 0 &&
+         cancel == NULL))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Search search;
+    search.instance.distances = distances;
+    search.instance.stride = num_cities;
+    search.instance.num_cities = num_cities;
+    search.instance.seed = 0;
+    search.options = *options;
+    search.cancel = cancel;
+    search.callback = callback;
+    search.user_data = user_data;
+    search.best_distance = INT_MAX;
+    search.best_thread = -1;
+    search.stop_reason = RUNNING;
+    clock_gettime(CLOCK_MONOTONIC, &search.start);
+
+    // Restart stagnating threads after a number of moves that grows with the instance
+    search.stagnation = options->stagnation;
+    if (search.stagnation == 0)
+    {
+        search.stagnation = num_cities * STAGNATION_PER_CITY > MIN_STAGNATION ? num_cities * STAGNATION_PER_CITY
+                                                                              : MIN_STAGNATION;
+    }
+
+    // Check whether the matrix is symmetric, which lets inversions be evaluated in constant time
+    search.instance.symmetric = 1;
+    for (int i = 0; i < num_cities && search.instance.symmetric; ++i)
+    {
+        for (int j = i + 1; j < num_cities; ++j)
+        {
+            if (distances[(size_t)i * num_cities + j] != distances[(size_t)j * num_cities + i])
+            {
+                search.instance.symmetric = 0;
+                break;
+            }
+        }
+    }
+
+    search.best_path = malloc(num_cities * sizeof(int));
+    search.cities = malloc(num_cities * sizeof(int));
+    if (search.best_path == NULL || search.cities == NULL)
+    {
+        free(search.best_path);
+        free(search.cities);
+        errno = ENOMEM;
+        return -1;
+    }
+    for (int i = 0; i < num_cities; ++i)
+    {
+        search.cities[i] = i + 1;
+    }
+    search.instance.cities = search.cities;
+    int error = pthread_mutex_init(&search.lock, NULL);
+    if (error != 0)
+    {
+        free(search.best_path);
+        free(search.cities);
+        errno = error;
+        return -1;
+    }
+
+    // Small instances are solved exactly; tours of up to three cities all have the same cities in order
+    int exact_max = options->exact_max_cities < TSP_EXACT_LIMIT ? options->exact_max_cities : TSP_EXACT_LIMIT;
+    long long total_iterations = 0;
+    if (num_cities <= 3 || num_cities <= exact_max)
+    {
+        error = core_held_karp_tour(&search.instance, search.cities, num_cities, search.best_path) == 0 ? 0 : errno;
+        if (error == 0)
+        {
+            search.best_distance = core_path_distance(&search.instance, search.best_path);
+
+            // The table is built in one go, so the callback can only turn the stop reason into a cancellation
+            if (callback != NULL)
+            {
+                TspProgress progress;
+                progress.distance = search.best_distance;
+                progress.elapsed_ms = get_elapsed_ms(&search);
+                progress.iterations = 0;
+                progress.thread_id = -1;
+                if (callback(search.best_path, num_cities, &progress, user_data) != 0)
+                {
+                    set_stop_reason(&search, TSP_STOP_CANCELLED);
+                }
+            }
+            set_stop_reason(&search, TSP_STOP_EXACT);
+        }
+    }
+    else
+    {
+        // Every buffer is allocated before any thread starts, so a thread never fails on its own
+        int num_threads = options->num_threads;
+        int ready = 0;
+        Worker *workers = calloc(num_threads, sizeof(Worker));
+        error = workers == NULL ? ENOMEM : 0;
+        for (; error == 0 && ready < num_threads; ++ready)
+        {
+            Worker *worker = &workers[ready];
+            worker->search = &search;
+            worker->id = ready;
+            worker->context = search.instance;
+            worker->context.seed = options->seed + ready;
+            worker->path = malloc(num_cities * sizeof(int));
+            worker->local_best = malloc(num_cities * sizeof(int));
+            if (worker->path == NULL || worker->local_best == NULL)
+            {
+                free(worker->path);
+                free(worker->local_best);
+                error = ENOMEM;
+                break;
+            }
+            core_random_path(&worker->context, worker->local_best);
+            if (tour_init(&worker->tour, worker->local_best, num_cities, num_cities,
+                          num_cities >= TOUR_LIST_THRESHOLD) == -1)
+            {
+                free(worker->path);
+                free(worker->local_best);
+                error = ENOMEM;
+                break;
+            }
+        }
+
+        // Start the threads; if one cannot be created the ones already running are stopped
+        int started = 0;
+        for (; error == 0 && started < num_threads; ++started)
+        {
+            error = pthread_create(&workers[started].thread, NULL, run_algorithm, &workers[started]);
+            if (error != 0)
+            {
+                set_stop_reason(&search, TSP_STOP_CANCELLED);
+                break;
+            }
+        }
+        for (int i = 0; i < started; ++i)
+        {
+            pthread_join(workers[i].thread, NULL);
+            total_iterations += workers[i].iterations;
+        }
+        if (workers != NULL)
+        {
+            free_workers(workers, ready);
+        }
+
+        // Threads that all ran out of iterations leave no other reason
+        set_stop_reason(&search, TSP_STOP_ITERATIONS);
+    }
+
+    pthread_mutex_destroy(&search.lock);
+    free(search.cities);
+    if (error != 0)
+    {
+        free(search.best_path);
+        errno = error;
+        return -1;
+    }
+
+    result->path = search.best_path;
+    result->num_cities = num_cities;
+    result->distance = search.best_distance;
+    result->elapsed_ms = get_elapsed_ms(&search);
+    result->iterations = total_iterations;
+    result->best_thread = search.best_thread;
+    result->stop_reason = search.stop_reason;
+    return 0;
+}
+
+void tsp_result_free(TspResult *result)
+{
+    free(result->path);
+    result->path = NULL;
+}
@@ -0,0 +1,104 @@
+#ifndef TSP_SOLVER_H
+#define TSP_SOLVER_H
+
+// Solving core packaged as a library: every call owns its state, runs its workers as threads of the
+// calling process and returns the best tour in a TspResult. Nothing is printed and no IPC object is created.
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Instances with at most this many cities are solved exactly with Held-Karp by default
+#define TSP_EXACT_MAX_CITIES 13
+// Largest instance the Held-Karp table is ever built for (2^19 sets of 19 cities)
+#define TSP_EXACT_LIMIT 20
+#define TSP_MAX_THREADS 256
+
+// Reasons a solve stopped
+#define TSP_STOP_TIME 0       // The time limit was reached
+#define TSP_STOP_ITERATIONS 1 // Every thread ran its iteration limit
+#define TSP_STOP_TARGET 2     // A tour at or below the target distance was found
+#define TSP_STOP_CANCELLED 3  // The cancellation token was set
+#define TSP_STOP_EXACT 4      // The instance was small enough to be solved exactly: the tour is optimal
+
+// Options of one solve, filled with defaults by tsp_default_options
+typedef struct
+{
+    int num_threads;          // Worker threads searching in parallel
+    long max_time_ms;         // Time limit in milliseconds, 0 for none
+    long long max_iterations; // Moves tried per thread, 0 for none
+    int target_distance;      // Stop as soon as a tour this short is found, -1 to disable
+    unsigned int seed;        // Seed of the first thread; thread i uses seed + i
+    long stagnation;          // Moves without improvement before a thread kicks its tour, 0 to size it from the instance
+    int exact_max_cities;     // Instances up to this size are solved with Held-Karp, 0 to never do it
+} TspOptions;
+
+// Cancellation token shared between the caller and a running solve
+// Any thread may call tsp_cancel on it; the workers check it every few hundred moves, the exact solver never
+typedef struct
+{
+    volatile int cancelled;
+} TspCancel;
+
+// Progress passed to the improvement callback
+typedef struct
+{
+    int distance;         // Distance of the new best tour
+    long elapsed_ms;      // Time since the solve started
+    long long iterations; // Moves tried so far by the thread that found the tour
+    int thread_id;        // Thread that found the tour, -1 for the exact solver
+} TspProgress;
+
+// Called every time the best tour of a solve improves, never by two threads at once
+// path holds num_cities cities numbered from 1 and is only valid during the call
+// Returning nonzero stops the solve as if it had been cancelled; the exact solver calls it once, after its
+// table is complete, so there it only changes the stop reason of the optimal tour to TSP_STOP_CANCELLED
+typedef int (*TspCallback)(const int *path, int num_cities, const TspProgress *progress, void *user_data);
+
+// Result of a solve; path is allocated by tsp_solve and released with tsp_result_free
+typedef struct
+{
+    int *path;            // Best tour found, cities numbered from 1
+    int num_cities;       // Number of cities in path
+    int distance;         // Distance of the best tour
+    long elapsed_ms;      // Duration of the solve
+    long long iterations; // Moves tried by all threads
+    int best_thread;      // Thread that found the best tour, -1 for the exact solver
+    int stop_reason;      // One of the TSP_STOP_* values
+} TspResult;
+
+// Function to fill options with the defaults: one thread, one second, no target, exact up to TSP_EXACT_MAX_CITIES
+void tsp_default_options(TspOptions *options);
+
+// Function to set a cancellation token back to not cancelled before it is reused
+void tsp_cancel_init(TspCancel *cancel);
+
+// Function to ask every solve using a cancellation token to stop and return its best tour
+void tsp_cancel(TspCancel *cancel);
+
+// Function to check whether a cancellation token was set
+int tsp_cancelled(const TspCancel *cancel);
+
+// Function to read a matrix file in the format of the executables (the size, then the distances row by row)
+// On success *distances is allocated with malloc and owned by the caller; returns 0, or -1 with errno set
+int tsp_load_matrix(const char *filename, int **distances, int *num_cities);
+
+// Function to calculate the distance of a closed path over a row-major num_cities x num_cities matrix
+int tsp_path_distance(const int *distances, int num_cities, const int *path);
+
+// Function to search for a short tour over a row-major num_cities x num_cities matrix
+// options may be NULL for the defaults; cancel, callback and user_data may be NULL
+// Returns 0 and fills result, or -1 with errno set: EINVAL for bad arguments or a solve nothing could stop
+// (no time limit, iteration limit, target or token), ENOMEM, or the error of pthread_create
+int tsp_solve(const int *distances, int num_cities, const TspOptions *options, TspCancel *cancel,
+              TspCallback callback, void *user_data, TspResult *result);
+
+// Function to release the tour of a result
+void tsp_result_free(TspResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
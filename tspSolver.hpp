@@ -0,0 +1,186 @@
+#ifndef TSP_SOLVER_HPP
+#define TSP_SOLVER_HPP
+
+// C++ interface of the solving core: the same solve as tsp_solve, with standard containers,
+// a std::function callback and exceptions instead of errno
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "tspSolver.h"
+
+namespace tsp
+{
+
+// Why a solve stopped
+enum class StopReason
+{
+    Time = TSP_STOP_TIME,
+    Iterations = TSP_STOP_ITERATIONS,
+    Target = TSP_STOP_TARGET,
+    Cancelled = TSP_STOP_CANCELLED,
+    Exact = TSP_STOP_EXACT
+};
+
+// Distances between cities, stored row by row
+struct Matrix
+{
+    int num_cities = 0;
+    std::vector<int> distances; // num_cities * num_cities entries
+
+    // Function to read a matrix file in the format of the executables
+    static Matrix load(const std::string &filename)
+    {
+        int *distances = nullptr;
+        int num_cities = 0;
+        if (tsp_load_matrix(filename.c_str(), &distances, &num_cities) == -1)
+        {
+            throw std::system_error(errno, std::generic_category(), "Error reading " + filename);
+        }
+        Matrix matrix;
+        matrix.num_cities = num_cities;
+        matrix.distances.assign(distances, distances + (size_t)num_cities * num_cities);
+        std::free(distances);
+        return matrix;
+    }
+};
+
+// Options of one solve; a zero duration or iteration count means no limit
+struct Options
+{
+    int num_threads = 1;
+    std::chrono::milliseconds max_time{1000};
+    long long max_iterations = 0; // Moves tried per thread
+    int target_distance = -1;     // Stop at a tour this short, -1 to disable
+    unsigned int seed = 1;
+    long stagnation = 0;          // Moves without improvement before a kick, 0 to size it from the instance
+    int exact_max_cities = TSP_EXACT_MAX_CITIES;
+};
+
+// Token the caller keeps to stop a solve from any thread; it may be shared by several solves
+class CancellationToken
+{
+public:
+    CancellationToken() { tsp_cancel_init(&token_); }
+    CancellationToken(const CancellationToken &) = delete;
+    CancellationToken &operator=(const CancellationToken &) = delete;
+
+    void cancel() { tsp_cancel(&token_); }
+    bool cancelled() const { return tsp_cancelled(&token_) != 0; }
+    void reset() { tsp_cancel_init(&token_); }
+    TspCancel *get() { return &token_; }
+
+private:
+    TspCancel token_;
+};
+
+// New best tour reported to the improvement callback
+struct Progress
+{
+    int distance;
+    std::chrono::milliseconds elapsed;
+    long long iterations; // Moves tried by the thread that found the tour
+    int thread_id;        // -1 for the exact solver
+};
+
+// Called with the new best tour (cities numbered from 1) every time it improves, never concurrently
+using ImprovementCallback = std::function<void(const std::vector<int> &path, const Progress &progress)>;
+
+// Outcome of a solve
+struct Result
+{
+    std::vector<int> path; // Best tour, cities numbered from 1
+    int distance;
+    std::chrono::milliseconds elapsed;
+    long long iterations; // Moves tried by all threads
+    int best_thread;      // -1 for the exact solver
+    StopReason stop_reason;
+};
+
+namespace detail
+{
+// Callback state: an exception thrown by the user callback stops the solve and is rethrown by solve
+struct CallbackContext
+{
+    const ImprovementCallback *callback;
+    std::exception_ptr error;
+    std::vector<int> path;
+};
+
+inline int forward_improvement(const int *path, int num_cities, const TspProgress *progress, void *user_data)
+{
+    CallbackContext *context = static_cast<CallbackContext *>(user_data);
+    try
+    {
+        context->path.assign(path, path + num_cities);
+        Progress converted{progress->distance, std::chrono::milliseconds(progress->elapsed_ms),
+                           progress->iterations, progress->thread_id};
+        (*context->callback)(context->path, converted);
+        return 0;
+    }
+    catch (...)
+    {
+        context->error = std::current_exception();
+        return 1;
+    }
+}
+} // namespace detail
+
+// Function to search for a short tour; throws std::invalid_argument for bad arguments,
+// std::system_error when the solve cannot run, and rethrows any exception of the callback
+inline Result solve(const Matrix &matrix, const Options &options = Options(), CancellationToken *cancel = nullptr,
+                    const ImprovementCallback &on_improvement = ImprovementCallback())
+{
+    if (matrix.num_cities < 1 || matrix.distances.size() != (size_t)matrix.num_cities * matrix.num_cities)
+    {
+        throw std::invalid_argument("Matrix must hold num_cities * num_cities distances");
+    }
+
+    TspOptions c_options;
+    c_options.num_threads = options.num_threads;
+    c_options.max_time_ms = (long)options.max_time.count();
+    c_options.max_iterations = options.max_iterations;
+    c_options.target_distance = options.target_distance;
+    c_options.seed = options.seed;
+    c_options.stagnation = options.stagnation;
+    c_options.exact_max_cities = options.exact_max_cities;
+
+    TspResult c_result;
+    detail::CallbackContext context{&on_improvement, nullptr, {}};
+    int status = tsp_solve(matrix.distances.data(), matrix.num_cities, &c_options,
+                           cancel != nullptr ? cancel->get() : nullptr,
+                           on_improvement ? detail::forward_improvement : nullptr, &context, &c_result);
+    if (status == -1)
+    {
+        if (errno == EINVAL)
+        {
+            throw std::invalid_argument("Invalid solver options");
+        }
+        throw std::system_error(errno, std::generic_category(), "Error running the solver");
+    }
+
+    Result result;
+    result.path.assign(c_result.path, c_result.path + c_result.num_cities);
+    result.distance = c_result.distance;
+    result.elapsed = std::chrono::milliseconds(c_result.elapsed_ms);
+    result.iterations = c_result.iterations;
+    result.best_thread = c_result.best_thread;
+    result.stop_reason = static_cast<StopReason>(c_result.stop_reason);
+    tsp_result_free(&c_result);
+
+    if (context.error)
+    {
+        std::rethrow_exception(context.error);
+    }
+    return result;
+}
+
+} // namespace tsp
+
+#endif